@@ -12,6 +12,8 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <vector>
+
 #include "common/exception.h"
 #include "common/macros.h"
 
@@ -25,12 +27,20 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManag
   // we allocate a consecutive memory space for the buffer pool
   // LOG_DEBUG("pool_size:%ld, k:%ld", pool_size, replacer_k);
   pages_ = new Page[pool_size_];
-  page_table_ = new ExtendibleHashTable<page_id_t, frame_id_t>(bucket_size_);
+  for (auto &shard : shards_) {
+    shard.table_.Init(pool_size_);
+  }
   replacer_ = new LRUKReplacer(pool_size, replacer_k);
 
-  // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+  // Initially, every page is in the free list, threaded in ascending order so
+  // frames are first handed out 0, 1, 2, ...
+  free_next_.resize(pool_size_);
+  for (size_t i = 0; i + 1 < pool_size_; ++i) {
+    free_next_[i] = static_cast<uint32_t>(i + 1);
+  }
+  if (pool_size_ > 0) {
+    free_next_[pool_size_ - 1] = FREE_LIST_NIL;
+    free_head_.store(0, std::memory_order_release);
   }
 
   // TODO(students): remove this line after you have implemented the buffer pool manager
@@ -41,18 +51,33 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManag
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
   delete[] pages_;
-  delete page_table_;
   delete replacer_;
 }
 
+auto BufferPoolManagerInstance::AcquireVictim(frame_id_t *frame_id) -> bool {
+  std::vector<frame_id_t> skipped;
+  bool claimed = false;
+  while (replacer_->Evict(frame_id)) {
+    if (pages_[*frame_id].GetPinCount() == 0) {
+      claimed = true;
+      break;
+    }
+    // The frame was re-pinned after being marked evictable; set it aside and
+    // try the next victim.
+    skipped.push_back(*frame_id);
+  }
+  for (const auto &frame : skipped) {
+    replacer_->RecordAccess(frame);
+    replacer_->SetEvictable(frame, true);
+  }
+  return claimed;
+}
+
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
   // std::scoped_lock<std::mutex> lock(latch_);
   latch_.lock();
   frame_id_t frame_id;
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-  } else if (!replacer_->Evict(&frame_id)) {
+  if (!PopFreeFrame(&frame_id) && !AcquireVictim(&frame_id)) {
     page_id = nullptr;
     latch_.unlock();
     return nullptr;
@@ -61,120 +86,207 @@ auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
   *page_id = AllocatePage();
   Page *page = &pages_[frame_id];
   // LOG_DEBUG("NewPgImp, page_id:%d", *page_id);
-  if (page->IsDirty()) {
-    disk_manager_->WritePage(page->GetPageId(), page->GetData());
+  page_id_t old_id = page->GetPageId();
+  bool dirty = page->IsDirty();
+  EraseFrame(old_id);
+  // The frame is exclusively ours (no mapping, not in the replacer), so the
+  // victim write-out can run outside the latch. Guard both ids so concurrent
+  // fetches of them wait for the I/O instead of racing it.
+  if (dirty) {
+    BeginIo(old_id);
+  }
+  BeginIo(*page_id);
+  page->pin_count_ = 1;
+  replacer_->Pin(frame_id);
+  latch_.unlock();
+
+  if (dirty) {
+    disk_manager_->WritePage(old_id, page->GetData());
     page->is_dirty_ = false;
+    EndIo(old_id);
   }
-  page_table_->Remove(page->GetPageId());
   page->ResetMemory();
   page->page_id_ = *page_id;
-  page->pin_count_ = 1;
-  page_table_->Insert(*page_id, frame_id);
-  replacer_->RecordAccess(frame_id);
-  replacer_->SetEvictable(frame_id, false);
-  latch_.unlock();
+  InsertFrame(*page_id, frame_id);
+  EndIo(*page_id);
   return page;
 }
 
 auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   // LOG_DEBUG("FetchPgImp, page_id:%d", page_id);
-  // std::scoped_lock<std::mutex> lock(latch_);
-  latch_.lock();
-  frame_id_t frame_id;
-  if (!page_table_->Find(page_id, frame_id)) {
-    if (!free_list_.empty()) {
-      frame_id = free_list_.front();
-      free_list_.pop_front();
-    } else {
-      if (!replacer_->Evict(&frame_id)) {
+  while (true) {
+    // Fast path under the shared latch: a hit never rebinds a frame, so
+    // concurrent hits don't serialise on the BPM lock.
+    {
+      latch_.lock_shared();
+      {
+        std::unique_lock<std::mutex> io_lock(io_latch_);
+        if (IoInFlight(page_id)) {
+          latch_.unlock_shared();
+          io_cv_.wait(io_lock, [&] { return !IoInFlight(page_id); });
+          continue;
+        }
+      }
+      frame_id_t frame_id;
+      if (FindFrame(page_id, &frame_id)) {
+        replacer_->Pin(frame_id);
+        Page *page = &pages_[frame_id];
+        ++page->pin_count_;
+        latch_.unlock_shared();
+        return page;
+      }
+      latch_.unlock_shared();
+    }
+
+    // Miss: retry under the exclusive latch (the page may have arrived while
+    // we upgraded). The in-flight check comes before the lookup: new I/O only
+    // starts under the exclusive latch, and a finished load publishes its
+    // mapping before clearing the in-flight mark, so a clear check here
+    // guarantees the lookup below sees any completed load.
+    latch_.lock();
+    {
+      std::unique_lock<std::mutex> io_lock(io_latch_);
+      if (IoInFlight(page_id)) {
+        latch_.unlock();
+        io_cv_.wait(io_lock, [&] { return !IoInFlight(page_id); });
+        continue;
+      }
+    }
+
+    frame_id_t frame_id;
+    if (FindFrame(page_id, &frame_id)) {
+      replacer_->Pin(frame_id);
+      Page *page = &pages_[frame_id];
+      ++page->pin_count_;
+      latch_.unlock();
+      return page;
+    }
+
+    if (!PopFreeFrame(&frame_id)) {
+      if (!AcquireVictim(&frame_id)) {
         latch_.unlock();
         return nullptr;
       }
     }
-  } else {
-    replacer_->RecordAccess(frame_id);
-    replacer_->SetEvictable(frame_id, false);
+
+    // 没找到，磁盘读取，替换帧
     Page *page = &pages_[frame_id];
-    ++page->pin_count_;
+    page_id_t old_id = page->GetPageId();
+    bool dirty = page->IsDirty();
+    EraseFrame(old_id);
+    if (dirty) {
+      BeginIo(old_id);
+    }
+    BeginIo(page_id);
+    page->pin_count_ = 1;
+    replacer_->Pin(frame_id);
     latch_.unlock();
-    return &pages_[frame_id];
-  }
 
-  // 没找到，磁盘读取，替换帧
-  Page *page = &pages_[frame_id];
-  if (page->IsDirty()) {
-    disk_manager_->WritePage(page->GetPageId(), page->GetData());
-    page->is_dirty_ = false;
+    // Disk I/O runs outside the latch; the frame is unreachable (no page-table
+    // mapping) and both page ids are marked in flight.
+    if (dirty) {
+      // chained write-out + fault read through the same buffer
+      disk_manager_->SwapPage(old_id, page_id, page->data_);
+      page->is_dirty_ = false;
+      EndIo(old_id);
+    } else {
+      // no memset needed: ReadPage fills the whole frame, zero-padding any
+      // part past the end of the file
+      disk_manager_->ReadPage(page_id, page->data_);
+    }
+    page->page_id_ = page_id;
+    InsertFrame(page_id, frame_id);
+    EndIo(page_id);
+    return page;
   }
-  page_table_->Remove(page->GetPageId());
-
-  page->ResetMemory();
-  disk_manager_->ReadPage(page_id, page->data_);
-  page->page_id_ = page_id;
-  page->pin_count_ = 1;
+}
 
-  page_table_->Insert(page_id, frame_id);
-  replacer_->RecordAccess(frame_id);
-  replacer_->SetEvictable(frame_id, false);
-  latch_.unlock();
-  return &pages_[frame_id];
+void BufferPoolManagerInstance::PrefetchPage(page_id_t page_id) {
+  // Best-effort cache warming: only the shard lookup is taken, no pin and no
+  // frame-state latch. The frame may be rebound between this and the caller's
+  // FetchPage — prefetching stale bytes is harmless, a faulting read is not,
+  // and __builtin_prefetch never faults. A miss does nothing: a synchronous
+  // disk read here would stall the caller instead of hiding latency.
+  frame_id_t frame_id;
+  if (!FindFrame(page_id, &frame_id)) {
+    return;
+  }
+  const char *data = pages_[frame_id].GetData();
+  // 128B stride: the adjacent-line prefetcher pulls the other half of each pair
+  for (size_t offset = 0; offset < BUSTUB_PAGE_SIZE; offset += 128) {
+    __builtin_prefetch(data + offset);
+  }
 }
 
 auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
-  // std::scoped_lock<std::mutex> lock(latch_);
   // LOG_DEBUG("UnpinPgImp, page_id:%d, is_dirty:%d", page_id, is_dirty);
-  latch_.lock();
+  // Lock-free fast path: unpinning is the hottest BPM entry point, and only
+  // needs the page-table shard for the lookup plus atomic pin/dirty updates.
   frame_id_t frame_id;
-  if (!page_table_->Find(page_id, frame_id)) {
-    latch_.unlock();
+  if (!FindFrame(page_id, &frame_id)) {
     return false;
   }
 
   Page *page = &pages_[frame_id];
-  page->is_dirty_ |= is_dirty;
-
-  if (page->GetPinCount() <= 0) {
-    latch_.unlock();
-    return false;
+  if (is_dirty) {
+    page->is_dirty_.store(true, std::memory_order_release);
   }
 
-  --page->pin_count_;
-  if (page->GetPinCount() == 0) {
+  int pin_count = page->pin_count_.load(std::memory_order_acquire);
+  do {
+    if (pin_count <= 0) {
+      return false;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1, std::memory_order_acq_rel));
+
+  if (pin_count == 1) {
     replacer_->SetEvictable(frame_id, true);
   }
-  latch_.unlock();
   return true;
 }
 
 auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
   // LOG_DEBUG("FlushPgImp, page_id:%d", page_id);
-  // std::scoped_lock<std::mutex> lock(latch_);
-  latch_.lock();
+  // A flush never rebinds a frame, so the shared latch is enough to keep the
+  // mapping stable while we write.
+  latch_.lock_shared();
   frame_id_t frame_id;
-  if (!page_table_->Find(page_id, frame_id)) {
-    latch_.unlock();
+  if (!FindFrame(page_id, &frame_id)) {
+    latch_.unlock_shared();
     return false;
   }
 
   Page *page = pages_ + frame_id;
   disk_manager_->WritePage(page_id, page->GetData());
   page->is_dirty_ = false;
-  latch_.unlock();
+  latch_.unlock_shared();
   return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // std::scoped_lock<std::mutex> lock(latch_);
   // LOG_DEBUG("FlushAllPgsImp");
-  latch_.lock();
+  latch_.lock_shared();
   for (size_t i = 0; i < pool_size_; ++i) {
     Page *page = pages_ + i;
-    if (page->GetPageId() != INVALID_PAGE_ID) {
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-      page->is_dirty_ = false;
+    // Only dirty frames need I/O; the per-frame atomic dirty flags are the
+    // dirty-page set, so clean frames cost one flag load instead of a 4 KiB
+    // write.
+    if (page->GetPageId() == INVALID_PAGE_ID || !page->IsDirty()) {
+      continue;
     }
+    {
+      // Skip frames whose contents are being replaced right now; their owner
+      // is responsible for the write-out.
+      std::scoped_lock<std::mutex> io_lock(io_latch_);
+      if (IoInFlight(page->GetPageId())) {
+        continue;
+      }
+    }
+    disk_manager_->WritePage(page->GetPageId(), page->GetData());
+    page->is_dirty_ = false;
   }
-  latch_.unlock();
+  latch_.unlock_shared();
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
@@ -182,7 +294,7 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   // LOG_DEBUG("DeletePgImp, page_id:%d", page_id);
   latch_.lock();
   frame_id_t frame_id;
-  if (!page_table_->Find(page_id, frame_id)) {
+  if (!FindFrame(page_id, &frame_id)) {
     latch_.unlock();
     return true;
   }
@@ -194,15 +306,40 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   }
 
   page->ResetMemory();
-  page_table_->Remove(page_id);
+  EraseFrame(page_id);
   replacer_->Remove(frame_id);
-  free_list_.push_back(frame_id);
+  PushFreeFrame(frame_id);
 
   DeallocatePage(page_id);
   latch_.unlock();
   return true;
 }
 
+void BufferPoolManagerInstance::DeletePgsImp(const std::vector<page_id_t> &page_ids) {
+  if (page_ids.empty()) {
+    return;
+  }
+  // 整批只拿一次帧闩，逐页走DeletePgImp的回收流程；还pin着的页跳过，
+  // 语义同单页版返回false
+  latch_.lock();
+  for (page_id_t page_id : page_ids) {
+    frame_id_t frame_id;
+    if (!FindFrame(page_id, &frame_id)) {
+      continue;
+    }
+    Page *page = &pages_[frame_id];
+    if (page->GetPinCount() > 0) {
+      continue;
+    }
+    page->ResetMemory();
+    EraseFrame(page_id);
+    replacer_->Remove(frame_id);
+    PushFreeFrame(frame_id);
+    DeallocatePage(page_id);
+  }
+  latch_.unlock();
+}
+
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t { return next_page_id_++; }
 
 }  // namespace bustub
@@ -14,37 +14,58 @@
 
 namespace bustub {
 
-LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {}
+LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {
+  BUSTUB_ASSERT(k_ > 0 && k_ <= UINT8_MAX, "k out of range");
+  frames_.resize(num_frames);
+  hist_pool_.resize(num_frames * k_);
+  for (size_t i = 0; i < num_frames; ++i) {
+    frames_[i].frame_id_ = static_cast<frame_id_t>(i);
+  }
+}
+
+void LRUKReplacer::IndexInsert(const FrameInfo &info) {
+  if (info.len_ < k_) {
+    inf_set_.insert(KeyOf(info));
+  } else {
+    kth_set_.insert(KeyOf(info));
+  }
+}
+
+void LRUKReplacer::IndexErase(const FrameInfo &info) {
+  if (info.len_ < k_) {
+    inf_set_.erase(KeyOf(info));
+  } else {
+    kth_set_.erase(KeyOf(info));
+  }
+}
+
+auto LRUKReplacer::EvictInternal(frame_id_t *frame_id) -> bool {
+  // Frames with fewer than k accesses have +inf backward k-distance and are
+  // preferred, FIFO by first access; otherwise the smallest k-th backward
+  // timestamp is exactly the maximum backward k-distance.
+  auto &victims = !inf_set_.empty() ? inf_set_ : kth_set_;
+  if (victims.empty()) {
+    return false;
+  }
+  *frame_id = victims.begin()->second;
+  victims.erase(victims.begin());
+  return true;
+}
 
 auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
   std::scoped_lock<std::mutex> lock(latch_);
   // LOG_INFO("Evict");
-  ++current_timestamp_;
-  size_t old_timestamp = 0;
-  bool result = false;
-  auto iter = list_.begin();
-  for (; iter != list_.end(); ++iter) {
-    if (iter->is_evictable_) {
-      if (iter->hast_.size() < k_) {
-        *frame_id = iter->frame_id_;
-        result = true;
-        break;
-      }
-      size_t tmp = current_timestamp_ - iter->hast_.back();
-      if (tmp > old_timestamp) {
-        *frame_id = iter->frame_id_;
-        old_timestamp = tmp;
-        result = true;
-      }
-    }
+  if (!EvictInternal(frame_id)) {
+    return false;
   }
-
-  if (result) {
-    list_.erase(cache_[*frame_id]);
-    cache_.erase(*frame_id);
-    --curr_size_;
-  }
-  return result;
+  FrameInfo &info = frames_[*frame_id];
+  info.head_ = 0;
+  info.len_ = 0;
+  info.is_evictable_ = false;
+  info.in_replacer_ = false;
+  --frame_cnt_;
+  --curr_size_;
+  return true;
 }
 
 void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
@@ -52,55 +73,85 @@ void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
 
   ++current_timestamp_;
   // LOG_INFO("RecordAccess: %d", frame_id);
-  auto it = cache_.find(frame_id);
-  if (it != cache_.end()) {
-    it->second->hast_.push_front(current_timestamp_);
-    if (it->second->hast_.size() > k_) {
-      it->second->hast_.pop_back();
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "frame id out of range");
+  FrameInfo &info = frames_[frame_id];
+  if (info.in_replacer_) {
+    if (info.is_evictable_) {
+      // splice the node between (or within) the victim sets instead of
+      // erase + reinsert: extract/insert moves it without touching the
+      // allocator
+      auto node = (info.len_ < k_ ? inf_set_ : kth_set_).extract(KeyOf(info));
+      PushTs(info, current_timestamp_);
+      node.value() = KeyOf(info);
+      (info.len_ < k_ ? inf_set_ : kth_set_).insert(std::move(node));
+    } else {
+      PushTs(info, current_timestamp_);
     }
   } else {
-    if (list_.size() == replacer_size_) {
-      size_t old_timestamp = 0;
+    if (frame_cnt_ == replacer_size_) {
       frame_id_t replace_frame;
-      bool result = false;
-      auto iter = list_.begin();
-      for (; iter != list_.end(); ++iter) {
-        if (iter->is_evictable_) {
-          if (iter->hast_.size() < k_) {
-            replace_frame = iter->frame_id_;
-            result = true;
-            break;
-          }
-          size_t tmp = current_timestamp_ - iter->hast_.back();
-          if (tmp > old_timestamp) {
-            replace_frame = iter->frame_id_;
-            old_timestamp = tmp;
-            result = true;
-          }
-        }
+      if (EvictInternal(&replace_frame)) {
+        FrameInfo &victim = frames_[replace_frame];
+        victim.head_ = 0;
+        victim.len_ = 0;
+        victim.is_evictable_ = false;
+        victim.in_replacer_ = false;
+        --frame_cnt_;
       }
+    }
+    PushTs(info, current_timestamp_);
+    info.in_replacer_ = true;
+    ++frame_cnt_;
+  }
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::scoped_lock<std::mutex> lock(latch_);
 
-      if (result) {
-        list_.erase(cache_[replace_frame]);
-        cache_.erase(replace_frame);
+  ++current_timestamp_;
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "frame id out of range");
+  FrameInfo &info = frames_[frame_id];
+  if (info.in_replacer_) {
+    if (info.is_evictable_) {
+      // leaving the victim index anyway, so drop the key instead of re-keying
+      IndexErase(info);
+      info.is_evictable_ = false;
+      --curr_size_;
+    }
+    PushTs(info, current_timestamp_);
+  } else {
+    if (frame_cnt_ == replacer_size_) {
+      frame_id_t replace_frame;
+      if (EvictInternal(&replace_frame)) {
+        FrameInfo &victim = frames_[replace_frame];
+        victim.head_ = 0;
+        victim.len_ = 0;
+        victim.is_evictable_ = false;
+        victim.in_replacer_ = false;
+        --frame_cnt_;
       }
     }
-    list_.emplace_back(FrameInfo(frame_id, current_timestamp_));
-    cache_.emplace(frame_id, std::prev(list_.end()));
+    PushTs(info, current_timestamp_);
+    info.in_replacer_ = true;
+    ++frame_cnt_;
   }
 }
 
 void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
   std::scoped_lock<std::mutex> lock(latch_);
-  ++current_timestamp_;
   // LOG_INFO("SetEvictable: %d", frame_id);
-  auto it = cache_.find(frame_id);
-  if (it != cache_.end()) {
-    if (set_evictable && !it->second->is_evictable_) {
-      it->second->is_evictable_ = true;
+  if (static_cast<size_t>(frame_id) >= replacer_size_) {
+    return;
+  }
+  FrameInfo &info = frames_[frame_id];
+  if (info.in_replacer_) {
+    if (set_evictable && !info.is_evictable_) {
+      info.is_evictable_ = true;
+      IndexInsert(info);
       ++curr_size_;
-    } else if (!set_evictable && it->second->is_evictable_) {
-      it->second->is_evictable_ = false;
+    } else if (!set_evictable && info.is_evictable_) {
+      info.is_evictable_ = false;
+      IndexErase(info);
       --curr_size_;
     }
   }
@@ -108,15 +159,21 @@ void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
 
 void LRUKReplacer::Remove(frame_id_t frame_id) {
   std::scoped_lock<std::mutex> lock(latch_);
-  ++current_timestamp_;
   // LOG_INFO("REMOVE: %d", frame_id);
-  auto it = cache_.find(frame_id);
-  if (it != cache_.end()) {
-    if (!it->second->is_evictable_) {
+  if (static_cast<size_t>(frame_id) >= replacer_size_) {
+    return;
+  }
+  FrameInfo &info = frames_[frame_id];
+  if (info.in_replacer_) {
+    if (!info.is_evictable_) {
       abort();
     }
-    list_.erase(cache_[frame_id]);
-    cache_.erase(frame_id);
+    IndexErase(info);
+    info.head_ = 0;
+    info.len_ = 0;
+    info.is_evictable_ = false;
+    info.in_replacer_ = false;
+    --frame_cnt_;
     --curr_size_;
   }
 }
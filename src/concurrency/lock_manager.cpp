@@ -12,14 +12,150 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <algorithm>
+#include <future>
+#include <limits>
+
 #include "common/config.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 
 namespace bustub {
 
+namespace {
+
+/** 兼容性规则，与CheckCompatibility原分支逻辑一致，仅用于编译期建表 */
+constexpr auto Compatible(LockManager::LockMode hold_mode, LockManager::LockMode want_mode) -> bool {
+  using LockMode = LockManager::LockMode;
+  // IS > X
+  if (hold_mode == LockMode::INTENTION_SHARED && want_mode == LockMode::EXCLUSIVE) {
+    return false;
+  }
+  // IX > S,SIX,X
+  if (hold_mode == LockMode::INTENTION_EXCLUSIVE &&
+      (want_mode == LockMode::SHARED || want_mode == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+       want_mode == LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  // S > IX, SIX, X
+  if (hold_mode == LockMode::SHARED &&
+      (want_mode == LockMode::INTENTION_EXCLUSIVE || want_mode == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+       want_mode == LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  // SIX > IX, S, SIX, X
+  if (hold_mode == LockMode::SHARED_INTENTION_EXCLUSIVE && want_mode != LockMode::INTENTION_SHARED) {
+    return false;
+  }
+  // X > IS, IX, S, SIX, X
+  return hold_mode != LockMode::EXCLUSIVE;
+}
+
+/** 5×5兼容矩阵压成一个字：bit (hold*5+want) 为1表示兼容 */
+constexpr auto BuildCompatMask() -> uint32_t {
+  uint32_t mask = 0;
+  for (int hold = 0; hold < 5; ++hold) {
+    for (int want = 0; want < 5; ++want) {
+      if (Compatible(static_cast<LockManager::LockMode>(hold), static_cast<LockManager::LockMode>(want))) {
+        mask |= 1U << (hold * 5 + want);
+      }
+    }
+  }
+  return mask;
+}
+
+constexpr uint32_t kCompatMask = BuildCompatMask();
+
+/** kConflictsWith[want]：与want不兼容的持有模式位集 */
+constexpr auto BuildConflictMasks() -> std::array<uint8_t, 5> {
+  std::array<uint8_t, 5> masks{};
+  for (int want = 0; want < 5; ++want) {
+    for (int hold = 0; hold < 5; ++hold) {
+      if (!Compatible(static_cast<LockManager::LockMode>(hold), static_cast<LockManager::LockMode>(want))) {
+        masks[want] |= static_cast<uint8_t>(1U << hold);
+      }
+    }
+  }
+  return masks;
+}
+
+constexpr std::array<uint8_t, 5> kConflictsWith = BuildConflictMasks();
+
+/** 加锁前置校验的结果：放行或带原因abort */
+enum class Verdict : uint8_t { OK, ABORT_LOCK_ON_SHRINKING, ABORT_SHARED_ON_READ_UNCOMMITTED };
+
+/** 隔离级别/事务阶段/锁模式的准入规则，与原LockTable开头的if链一致，仅用于编译期建表。
+ * COMMITTED/ABORTED在查表前已经提前返回，表只覆盖GROWING/SHRINKING。 */
+constexpr auto LockVerdict(IsolationLevel iso, TransactionState state, LockManager::LockMode mode) -> Verdict {
+  using LockMode = LockManager::LockMode;
+  // 可重复读：收缩阶段不允许任何加锁
+  if (state == TransactionState::SHRINKING && iso == IsolationLevel::REPEATABLE_READ) {
+    return Verdict::ABORT_LOCK_ON_SHRINKING;
+  }
+  // 读已提交：收缩阶段只能申请IS, S锁
+  if (state == TransactionState::SHRINKING && iso == IsolationLevel::READ_COMMITTED && mode != LockMode::SHARED &&
+      mode != LockMode::INTENTION_SHARED) {
+    return Verdict::ABORT_LOCK_ON_SHRINKING;
+  }
+  // 读未提交：不允许共享类锁；X/IX也只能在扩张阶段申请
+  if (iso == IsolationLevel::READ_UNCOMMITTED) {
+    if (mode == LockMode::SHARED || mode == LockMode::INTENTION_SHARED ||
+        mode == LockMode::SHARED_INTENTION_EXCLUSIVE) {
+      return Verdict::ABORT_SHARED_ON_READ_UNCOMMITTED;
+    }
+    if (state == TransactionState::SHRINKING) {
+      return Verdict::ABORT_LOCK_ON_SHRINKING;
+    }
+  }
+  return Verdict::OK;
+}
+
+constexpr auto BuildPolicyTable() -> std::array<Verdict, 3 * 2 * 5> {
+  std::array<Verdict, 3 * 2 * 5> table{};
+  for (int iso = 0; iso < 3; ++iso) {
+    for (int state = 0; state < 2; ++state) {
+      for (int mode = 0; mode < 5; ++mode) {
+        table[(iso * 2 + state) * 5 + mode] = LockVerdict(
+            static_cast<IsolationLevel>(iso), static_cast<TransactionState>(state), static_cast<LockManager::LockMode>(mode));
+      }
+    }
+  }
+  return table;
+}
+
+constexpr std::array<Verdict, 3 * 2 * 5> kLockPolicy = BuildPolicyTable();
+
+/** 查表代替每次调用重走整条if链；调用方保证state为GROWING或SHRINKING */
+inline auto PolicyFor(Transaction *txn, LockManager::LockMode mode) -> Verdict {
+  auto iso = static_cast<size_t>(txn->GetIsolationLevel());
+  auto state = static_cast<size_t>(txn->GetState());
+  return kLockPolicy[(iso * 2 + state) * 5 + static_cast<size_t>(mode)];
+}
+
+/** kLegalUpgrade[old]的第new位为1表示允许old→new升级：
+ * IS→[S,X,IX,SIX]，S→[X,SIX]，IX→[X,SIX]，SIX→[X]，X→∅。
+ * 模式编号与LockMode一致：S=0, X=1, IS=2, IX=3, SIX=4。 */
+constexpr std::array<uint8_t, 5> kLegalUpgrade = {0b10010, 0b00000, 0b11011, 0b10010, 0b00010};
+
+/** 按模式取事务的行锁集合（行锁只有S/X），替代insert/erase处的if-else链 */
+inline auto RowLockSetFor(Transaction *txn, LockManager::LockMode mode)
+    -> std::unordered_map<table_oid_t, std::unordered_set<RID>> * {
+  return mode == LockManager::LockMode::SHARED ? txn->GetSharedRowLockSet().get()
+                                               : txn->GetExclusiveRowLockSet().get();
+}
+
+/** 按模式取事务的表锁集合，替代erase/insert处的两个五分支switch */
+inline auto TableLockSetFor(Transaction *txn, LockManager::LockMode mode) -> std::unordered_set<table_oid_t> * {
+  static constexpr std::array<std::shared_ptr<std::unordered_set<table_oid_t>> (Transaction::*)(), 5> kGetters = {
+      &Transaction::GetSharedTableLockSet, &Transaction::GetExclusiveTableLockSet,
+      &Transaction::GetIntentionSharedTableLockSet, &Transaction::GetIntentionExclusiveTableLockSet,
+      &Transaction::GetSharedIntentionExclusiveTableLockSet};
+  return (txn->*kGetters[static_cast<size_t>(mode)])().get();
+}
+
+}  // namespace
+
 auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool {
-  // LOG_INFO("LockTable: %d %d %d %d", txn->GetTransactionId(), (int)txn->GetIsolationLevel(), (int)lock_mode, oid);
   /***
    * 1. 检查txn的状态
    *    - 若在COMMITTED，ABORTED阶段，直接返回false
@@ -32,42 +168,36 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
     // throw std::logic_error("COMMITTED or ABORTED");
     return false;
   }
-  // 可重复读 两阶段
-  if (txn->GetState() == TransactionState::SHRINKING && txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) {
-    txn->SetState(TransactionState::ABORTED);
-    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
-  }
-
-  // 读已提交  收缩阶段只能申请IS, S锁
-  if (txn->GetState() == TransactionState::SHRINKING && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED &&
-      lock_mode != LockMode::SHARED && lock_mode != LockMode::INTENTION_SHARED) {
-    txn->SetState(TransactionState::ABORTED);
-    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
-  }
-
-  // 读未提交
-  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED) {
-    if (lock_mode == LockMode::SHARED || lock_mode == LockMode::INTENTION_SHARED ||
-        lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE) {
-      txn->SetState(TransactionState::ABORTED);
-      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_SHARED_ON_READ_UNCOMMITTED);
-    }
-    if (txn->GetState() == TransactionState::SHRINKING) {
+  // 隔离级别/阶段/模式的准入规则已在编译期建表，一次查表代替整条if链
+  switch (PolicyFor(txn, lock_mode)) {
+    case Verdict::ABORT_LOCK_ON_SHRINKING:
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
-    }
+    case Verdict::ABORT_SHARED_ON_READ_UNCOMMITTED:
+      txn->SetState(TransactionState::ABORTED);
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_SHARED_ON_READ_UNCOMMITTED);
+    case Verdict::OK:
+      break;
   }
 
   /***
    * 2. 获取锁请求队列，由tableoid获取，如果map中找不到，创建一个。
    */
 
-  table_lock_map_latch_.lock();
-  auto it = table_lock_map_.find(oid);
-  if (it == table_lock_map_.end()) {
-    table_lock_map_.insert({oid, std::make_shared<LockRequestQueue>()});
+  // 查队列只需要共享锁；建队列（每个oid只发生一次）才需要独占锁
+  auto &shard = TableShard(oid);
+  std::shared_ptr<LockRequestQueue> lock_request_queue;
+  {
+    std::shared_lock<std::shared_mutex> map_lock(shard.latch_);
+    auto it = shard.map_.find(oid);
+    if (it != shard.map_.end()) {
+      lock_request_queue = it->second;
+    }
+  }
+  if (lock_request_queue == nullptr) {
+    std::unique_lock<std::shared_mutex> map_lock(shard.latch_);
+    lock_request_queue = shard.map_.try_emplace(oid, std::make_shared<LockRequestQueue>()).first->second;
   }
-  std::shared_ptr<LockRequestQueue> lock_request_queue = table_lock_map_[oid];
 
   /***
    * 3. 判断事务是否在队列中，在的话进行锁升级操作，不在的话加入队列
@@ -80,17 +210,11 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
    *      - 创建LockRequest，加入队列
    */
 
-  // 先锁住再释放
+  // 队列不会从map中删除，shared_ptr保证其存活，可以在释放map锁之后再锁队列
   std::unique_lock<std::mutex> lock(lock_request_queue->latch_);
-  table_lock_map_latch_.unlock();
-  auto request_queue = lock_request_queue->request_queue_;
-  std::shared_ptr<LockRequest> lock_requset = nullptr;
-  for (auto &iter : request_queue) {
-    if (iter->txn_id_ == txn->GetTransactionId()) {
-      lock_requset = iter;
-      break;
-    }
-  }
+  auto &request_queue = lock_request_queue->request_queue_;
+  auto self_iter = lock_request_queue->FindRequest(txn->GetTransactionId());
+  LockRequest *lock_requset = self_iter == request_queue.end() ? nullptr : &*self_iter;
 
   // 升级锁
   if (lock_requset != nullptr) {
@@ -108,56 +232,22 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::UPGRADE_CONFLICT);
     }
-    // IS -> [S, X, IX, SIX]
-
-    // S -> [X, SIX]
-    if (lock_requset->lock_mode_ == LockMode::SHARED && lock_mode != LockMode::EXCLUSIVE &&
-        lock_mode != LockMode::SHARED_INTENTION_EXCLUSIVE) {
-      txn->SetState(TransactionState::ABORTED);
-      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::INCOMPATIBLE_UPGRADE);
-    }
-    // IX -> [X, SIX]
-    if (lock_requset->lock_mode_ == LockMode::INTENTION_EXCLUSIVE && lock_mode != LockMode::EXCLUSIVE &&
-        lock_mode != LockMode::SHARED_INTENTION_EXCLUSIVE) {
-      txn->SetState(TransactionState::ABORTED);
-      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::INCOMPATIBLE_UPGRADE);
-    }
-    // SIX -> [X]
-    if (lock_requset->lock_mode_ == LockMode::SHARED_INTENTION_EXCLUSIVE && lock_mode != LockMode::EXCLUSIVE) {
-      txn->SetState(TransactionState::ABORTED);
-      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::INCOMPATIBLE_UPGRADE);
-    }
-    if (lock_requset->lock_mode_ == LockMode::EXCLUSIVE) {
+    // 升级合法性一条位测试判完，代替逐模式if链
+    if ((kLegalUpgrade[static_cast<size_t>(lock_requset->lock_mode_)] & (1U << static_cast<size_t>(lock_mode))) == 0) {
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::INCOMPATIBLE_UPGRADE);
     }
 
     // 释放锁，准备重新加入锁进行锁升级
     auto old_lock_mode = lock_requset->lock_mode_;
-    switch (old_lock_mode) {
-      case LockMode::EXCLUSIVE:
-        txn->GetExclusiveTableLockSet()->erase(oid);
-        break;
-      case LockMode::SHARED:
-        txn->GetSharedTableLockSet()->erase(oid);
-        break;
-      case LockMode::INTENTION_EXCLUSIVE:
-        txn->GetIntentionExclusiveTableLockSet()->erase(oid);
-        break;
-      case LockMode::INTENTION_SHARED:
-        txn->GetIntentionSharedTableLockSet()->erase(oid);
-        break;
-      case LockMode::SHARED_INTENTION_EXCLUSIVE:
-        txn->GetSharedIntentionExclusiveTableLockSet()->erase(oid);
-        break;
-    }
-    lock_request_queue->request_queue_.remove(lock_requset);
+    TableLockSetFor(txn, old_lock_mode)->erase(oid);
+    lock_request_queue->Dequeue(self_iter);
+    lock_request_queue->OnRelease(old_lock_mode);
     lock_request_queue->upgrading_ = txn->GetTransactionId();
   }
 
-  std::shared_ptr<LockRequest> new_lock_request =
-      std::make_shared<LockRequest>(txn->GetTransactionId(), lock_mode, oid);
-  lock_request_queue->request_queue_.emplace_back(new_lock_request);
+  auto new_iter = lock_request_queue->Enqueue(txn->GetTransactionId(), lock_mode, oid);
+  LockRequest *new_lock_request = &*new_iter;
 
   /***
    * 4. 开始尝试获取锁
@@ -167,20 +257,21 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
    *    - 若为加锁操作，则遍历队列，查看优先级和兼容度
    */
 
-  // 当条件不满足时，自动释放锁，并挂起
-  while (!GrantTableLock(lock_request_queue, new_lock_request)) {
-    // LOG_INFO("wait %d %d", txn->GetTransactionId(), (int)txn->GetState());
-    lock_request_queue->cv_.wait(lock);
+  // 当条件不满足时，自动释放锁，并在本请求的条件变量上挂起
+  while (!GrantLock<false>(lock_request_queue, new_lock_request)) {
+    new_lock_request->cv_.wait(lock);
     if (txn->GetState() == TransactionState::ABORTED) {
-      // LOG_INFO("abort %d", txn->GetTransactionId());
       // 释放资源, 从队列中删除
-      lock_request_queue->request_queue_.remove(new_lock_request);
+      if (new_lock_request->granted_) {
+        lock_request_queue->OnRelease(new_lock_request->lock_mode_);
+      }
+      lock_request_queue->Dequeue(new_iter);
       // 如果升级失败  fixme finish upgradeTets升级失败，另一线程一直挂起
       if (lock_request_queue->upgrading_ == txn->GetTransactionId()) {
         lock_request_queue->upgrading_ = INVALID_TXN_ID;
       }
-      // FIXME FINISH: AbortTest超时？？锁竞争线程一直挂起，死循环 调用notify_all通知。
-      lock_request_queue->cv_.notify_all();
+      // 本请求出队后，后继等待者可能得以放行
+      GrantNewRequests(lock_request_queue.get());
       return false;
     }
   }
@@ -188,40 +279,33 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
   /***
    * 5. 向txn中添加记录，锁升级时需删除旧锁记录
    */
-  switch (lock_mode) {
-    case LockMode::EXCLUSIVE:
-      txn->GetExclusiveTableLockSet()->insert(oid);
-      break;
-    case LockMode::SHARED:
-      txn->GetSharedTableLockSet()->insert(oid);
-      break;
-    case LockMode::INTENTION_EXCLUSIVE:
-      txn->GetIntentionExclusiveTableLockSet()->insert(oid);
-      break;
-    case LockMode::INTENTION_SHARED:
-      txn->GetIntentionSharedTableLockSet()->insert(oid);
-      break;
-    case LockMode::SHARED_INTENTION_EXCLUSIVE:
-      txn->GetSharedIntentionExclusiveTableLockSet()->insert(oid);
-      break;
-  }
+  TableLockSetFor(txn, lock_mode)->insert(oid);
 
   return true;
 }
 
-auto LockManager::GrantTableLock(std::shared_ptr<LockRequestQueue> &lock_request_queue,
-                                 std::shared_ptr<LockRequest> &lock_request) -> bool {
+template <bool WithRid>
+auto LockManager::GrantLock(std::shared_ptr<LockRequestQueue> &lock_request_queue, LockRequest *lock_request) -> bool {
+  // 解锁方可能已经代为授予
+  if (lock_request->granted_) {
+    return true;
+  }
+  // 升级未决且不是本事务时谁都过不去，一次relaxed读提前出局
+  auto upgrading = lock_request_queue->upgrading_.load(std::memory_order_relaxed);
+  if (upgrading != INVALID_TXN_ID && upgrading != lock_request->txn_id_) {
+    return false;
+  }
   // FIX FINISH: X锁应该等待，与S锁不兼容 更新时首先判断与已授予的是否兼容
-  auto request_queue = lock_request_queue->request_queue_;
-  for (auto &iter : request_queue) {
-    if (iter->granted_ && !CheckCompatibility(iter->lock_mode_, lock_request->lock_mode_)) {
-      return false;
-    }
+  // 已授予模式位图一次AND判完，不再遍历已授予请求
+  if ((lock_request_queue->granted_modes_bits_ & kConflictsWith[static_cast<size_t>(lock_request->lock_mode_)]) != 0) {
+    return false;
   }
+  auto &request_queue = lock_request_queue->request_queue_;
 
   if (lock_request_queue->upgrading_ == lock_request->txn_id_) {
     lock_request_queue->upgrading_ = INVALID_TXN_ID;
     lock_request->granted_ = true;
+    lock_request_queue->OnGrant(lock_request->lock_mode_);
     return true;
   }
 
@@ -229,14 +313,21 @@ auto LockManager::GrantTableLock(std::shared_ptr<LockRequestQueue> &lock_request
     return false;
   }
 
-  // 再判断优先级
+  // 再判断优先级；行锁自匹配还要比对oid，编译期选择，表锁路径不带多余比较
   for (auto &iter : request_queue) {
-    if (iter->txn_id_ == lock_request->txn_id_) {
+    bool is_self;
+    if constexpr (WithRid) {
+      is_self = iter.txn_id_ == lock_request->txn_id_ && iter.oid_ == lock_request->oid_;
+    } else {
+      is_self = iter.txn_id_ == lock_request->txn_id_;
+    }
+    if (is_self) {
       lock_request->granted_ = true;
+      lock_request_queue->OnGrant(lock_request->lock_mode_);
       return true;
     }
 
-    if (!iter->granted_ && !CheckCompatibility(iter->lock_mode_, lock_request->lock_mode_)) {
+    if (!iter.granted_ && !CheckCompatibility(iter.lock_mode_, lock_request->lock_mode_)) {
       return false;
     }
   }
@@ -245,64 +336,37 @@ auto LockManager::GrantTableLock(std::shared_ptr<LockRequestQueue> &lock_request
 }
 
 auto LockManager::CheckCompatibility(LockMode hold_mode, LockMode want_mode) -> bool {
-  // IS > X
-  if (hold_mode == LockMode::INTENTION_SHARED && want_mode == LockMode::EXCLUSIVE) {
-    return false;
-  }
-  // IX > S,SIX,X
-  if (hold_mode == LockMode::INTENTION_EXCLUSIVE &&
-      (want_mode == LockMode::SHARED || want_mode == LockMode::SHARED_INTENTION_EXCLUSIVE ||
-       want_mode == LockMode::EXCLUSIVE)) {
-    return false;
-  }
-  // S > IX, SIX, X
-  if (hold_mode == LockMode::SHARED &&
-      (want_mode == LockMode::INTENTION_EXCLUSIVE || want_mode == LockMode::SHARED_INTENTION_EXCLUSIVE ||
-       want_mode == LockMode::EXCLUSIVE)) {
-    return false;
-  }
-  // SIX > IX, S, SIX, X
-  if (hold_mode == LockMode::SHARED_INTENTION_EXCLUSIVE && want_mode != LockMode::INTENTION_SHARED) {
-    return false;
-  }
-  // X > IS, IX, S, SIX, X
-  if (hold_mode == LockMode::EXCLUSIVE) {
-    return false;
-  }
-
-  return true;
+  // 授予判定和死锁检测的内层循环都会调用，查表代替分支链
+  return ((kCompatMask >> (static_cast<int>(hold_mode) * 5 + static_cast<int>(want_mode))) & 1U) != 0U;
 }
 
 auto LockManager::UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool {
-  // LOG_INFO("UnlockTable: %d %d", txn->GetTransactionId(), oid);
   /***
    * 判断是否有行级锁未释放
    */
   if (!((*txn->GetExclusiveRowLockSet())[oid].empty() && (*txn->GetSharedRowLockSet())[oid].empty())) {
-    // LOG_INFO("row lock is unlock");
     txn->SetState(TransactionState::ABORTED);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::TABLE_UNLOCKED_BEFORE_UNLOCKING_ROWS);
   }
 
-  table_lock_map_latch_.lock();
-  auto it = table_lock_map_.find(oid);
-  if (it == table_lock_map_.end()) {
-    table_lock_map_latch_.unlock();
+  auto &shard = TableShard(oid);
+  std::shared_ptr<LockRequestQueue> lock_request_queue;
+  {
+    std::shared_lock<std::shared_mutex> map_lock(shard.latch_);
+    auto it = shard.map_.find(oid);
+    if (it != shard.map_.end()) {
+      lock_request_queue = it->second;
+    }
+  }
+  if (lock_request_queue == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
   }
-  auto lock_request_queue = table_lock_map_[oid];
 
   std::unique_lock<std::mutex> lock(lock_request_queue->latch_);
-  table_lock_map_latch_.unlock();
-  std::list<std::shared_ptr<LockRequest>> request_queue = lock_request_queue->request_queue_;
-  std::shared_ptr<LockRequest> lock_request = nullptr;
-  for (auto &iter : request_queue) {
-    if (iter->txn_id_ == txn->GetTransactionId()) {
-      lock_request = iter;
-      break;
-    }
-  }
+  auto &request_queue = lock_request_queue->request_queue_;
+  auto self_iter = lock_request_queue->FindRequest(txn->GetTransactionId());
+  LockRequest *lock_request = self_iter == request_queue.end() ? nullptr : &*self_iter;
 
   if (lock_request == nullptr) {
     txn->SetState(TransactionState::ABORTED);
@@ -322,35 +386,20 @@ auto LockManager::UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool
   }
 
   auto lock_mode = lock_request->lock_mode_;
-  lock_request_queue->request_queue_.remove(lock_request);
-  switch (lock_mode) {
-    case LockMode::EXCLUSIVE:
-      txn->GetExclusiveTableLockSet()->erase(oid);
-      break;
-    case LockMode::SHARED:
-      txn->GetSharedTableLockSet()->erase(oid);
-      break;
-    case LockMode::INTENTION_EXCLUSIVE:
-      txn->GetIntentionExclusiveTableLockSet()->erase(oid);
-      break;
-    case LockMode::INTENTION_SHARED:
-      txn->GetIntentionSharedTableLockSet()->erase(oid);
-      break;
-    case LockMode::SHARED_INTENTION_EXCLUSIVE:
-      txn->GetSharedIntentionExclusiveTableLockSet()->erase(oid);
-      break;
-  }
+  lock_request_queue->Dequeue(self_iter);
+  lock_request_queue->OnRelease(lock_mode);
+  TableLockSetFor(txn, lock_mode)->erase(oid);
 
-  lock_request_queue->cv_.notify_all();
+  // 代为授予可以放行的等待者，只唤醒被授予的请求
+  GrantNewRequests(lock_request_queue.get());
 
   return true;
 }
 
-auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const RID &rid) -> bool {
+auto LockManager::ValidateRowLock(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool {
   /***
    * 检查表级索是否加锁，其余与locktable操作差不多
    */
-  // LOG_INFO("LockRow: %d %d %d %s", txn->GetTransactionId(), (int)lock_mode, oid, rid.ToString().c_str());
   if (txn->GetState() == TransactionState::ABORTED || txn->GetState() == TransactionState::COMMITTED) {
     // throw std::logic_error("COMMITTED or ABORTED");
     return false;
@@ -369,7 +418,6 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
     if (txn->GetIntentionSharedTableLockSet()->count(oid) == 0U && txn->GetSharedTableLockSet()->count(oid) == 0U &&
         txn->GetIntentionExclusiveTableLockSet()->count(oid) == 0U &&
         txn->GetExclusiveTableLockSet()->count(oid) == 0U) {
-      // LOG_INFO("S,IX,IS -> S");
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::TABLE_LOCK_NOT_PRESENT);
     }
@@ -378,43 +426,53 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
     if (txn->GetIntentionExclusiveTableLockSet()->count(oid) == 0U &&
         txn->GetSharedIntentionExclusiveTableLockSet()->count(oid) == 0U &&
         txn->GetExclusiveTableLockSet()->count(oid) == 0U) {
-      // LOG_INFO("X,IX,SIX -> X");
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::TABLE_LOCK_NOT_PRESENT);
     }
   }
 
-  // read_uncommitted 不能加S锁
-  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED && lock_mode == LockMode::SHARED) {
-    txn->SetState(TransactionState::ABORTED);
-    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_SHARED_ON_READ_UNCOMMITTED);
-  }
-  // 除了rc lock shared，其他都要修改状态
-  if (txn->GetState() == TransactionState::SHRINKING) {
-    if (!(txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED && lock_mode == LockMode::SHARED)) {
+  // 行锁只有S/X两种模式，准入规则与表锁同一张表
+  switch (PolicyFor(txn, lock_mode)) {
+    case Verdict::ABORT_LOCK_ON_SHRINKING:
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
-    }
+    case Verdict::ABORT_SHARED_ON_READ_UNCOMMITTED:
+      txn->SetState(TransactionState::ABORTED);
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_SHARED_ON_READ_UNCOMMITTED);
+    case Verdict::OK:
+      break;
   }
 
-  row_lock_map_latch_.lock();
-  auto it = row_lock_map_.find(rid);
-  if (it == row_lock_map_.end()) {
-    row_lock_map_.insert({rid, std::make_shared<LockRequestQueue>()});
+  return true;
+}
+
+auto LockManager::ResolveRowQueue(const RID &rid) -> std::shared_ptr<LockRequestQueue> {
+  auto &shard = RowShard(rid);
+  std::shared_ptr<LockRequestQueue> lock_request_queue;
+  {
+    std::shared_lock<std::shared_mutex> map_lock(shard.latch_);
+    auto it = shard.map_.find(rid);
+    if (it != shard.map_.end()) {
+      lock_request_queue = it->second;
+    }
+  }
+  if (lock_request_queue == nullptr) {
+    std::unique_lock<std::shared_mutex> map_lock(shard.latch_);
+    lock_request_queue = shard.map_.try_emplace(rid, std::make_shared<LockRequestQueue>()).first->second;
   }
-  auto lock_request_queue = row_lock_map_[rid];
+  return lock_request_queue;
+}
 
+auto LockManager::LockRowOnQueue(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const RID &rid,
+                                 std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool {
   std::unique_lock<std::mutex> lock(lock_request_queue->latch_);
-  row_lock_map_latch_.unlock();
 
-  auto request_queue = lock_request_queue->request_queue_;
-  std::shared_ptr<LockRequest> lock_request = nullptr;
-  for (auto &iter : request_queue) {
-    if (iter->txn_id_ == txn->GetTransactionId() && iter->oid_ == oid) {
-      lock_request = iter;
-      break;
-    }
+  auto &request_queue = lock_request_queue->request_queue_;
+  auto self_iter = lock_request_queue->FindRequest(txn->GetTransactionId());
+  if (self_iter != request_queue.end() && self_iter->oid_ != oid) {
+    self_iter = request_queue.end();
   }
+  LockRequest *lock_request = self_iter == request_queue.end() ? nullptr : &*self_iter;
 
   // 锁升级
   if (lock_request != nullptr) {
@@ -432,7 +490,8 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::UPGRADE_CONFLICT);
     }
 
-    if (lock_request->lock_mode_ == LockMode::EXCLUSIVE) {
+    // 行锁只有S/X，同一张升级位表：S→X合法，X不可再升级
+    if ((kLegalUpgrade[static_cast<size_t>(lock_request->lock_mode_)] & (1U << static_cast<size_t>(lock_mode))) == 0) {
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::INCOMPATIBLE_UPGRADE);
     }
@@ -440,110 +499,169 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
     // 持久化变换
     txn->GetSharedRowLockSet()->find(oid)->second.erase(rid);
 
-    lock_request_queue->request_queue_.remove(lock_request);
+    auto old_lock_mode = lock_request->lock_mode_;
+    lock_request_queue->Dequeue(self_iter);
+    lock_request_queue->OnRelease(old_lock_mode);
     lock_request_queue->upgrading_ = txn->GetTransactionId();
   }
 
-  auto new_lock_request = std::make_shared<LockRequest>(txn->GetTransactionId(), lock_mode, oid, rid);
-  lock_request_queue->request_queue_.emplace_back(new_lock_request);
+  auto new_iter = lock_request_queue->Enqueue(txn->GetTransactionId(), lock_mode, oid, rid);
+  LockRequest *new_lock_request = &*new_iter;
 
-  while (!GrantRowLock(lock_request_queue, new_lock_request)) {
-    lock_request_queue->cv_.wait(lock);
+  while (!GrantLock<true>(lock_request_queue, new_lock_request)) {
+    new_lock_request->cv_.wait(lock);
     if (txn->GetState() == TransactionState::ABORTED) {
-      lock_request_queue->request_queue_.remove(new_lock_request);
+      if (new_lock_request->granted_) {
+        lock_request_queue->OnRelease(new_lock_request->lock_mode_);
+      }
+      lock_request_queue->Dequeue(new_iter);
       if (lock_request_queue->upgrading_ == txn->GetTransactionId()) {
         lock_request_queue->upgrading_ = INVALID_TXN_ID;
       }
-      lock_request_queue->cv_.notify_all();
+      GrantNewRequests(lock_request_queue.get());
       return false;
     }
   }
 
-  // txn状态持久化
-  if (lock_mode == LockMode::SHARED) {
-    auto ms = txn->GetSharedRowLockSet();
-    if (ms->find(oid) == ms->end()) {
-      ms->insert({oid, std::unordered_set<RID>()});
-    }
-    (*ms)[oid].insert(rid);
-  } else if (lock_mode == LockMode::EXCLUSIVE) {
-    auto ms = txn->GetExclusiveRowLockSet();
-    if (ms->find(oid) == ms->end()) {
-      ms->insert({oid, std::unordered_set<RID>()});
-    }
-    (*ms)[oid].insert(rid);
-  }
+  // txn状态持久化；operator[]已含"无则建空集"的逻辑
+  (*RowLockSetFor(txn, lock_mode))[oid].insert(rid);
 
   return true;
 }
 
-auto LockManager::GrantRowLock(std::shared_ptr<LockRequestQueue> &lock_request_queue,
-                               std::shared_ptr<LockRequest> &lock_request) -> bool {
-  // 首先判断兼容性
-  auto request_queue = lock_request_queue->request_queue_;
-  for (auto &iter : request_queue) {
-    if (iter->granted_ && !CheckCompatibility(iter->lock_mode_, lock_request->lock_mode_)) {
-      return false;
-    }
+auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const RID &rid) -> bool {
+  if (!ValidateRowLock(txn, lock_mode, oid)) {
+    return false;
   }
-  // 是否升级
-  if (lock_request_queue->upgrading_ == lock_request->txn_id_) {
-    lock_request_queue->upgrading_ = INVALID_TXN_ID;
-    lock_request->granted_ = true;
+  auto lock_request_queue = ResolveRowQueue(rid);
+  return LockRowOnQueue(txn, lock_mode, oid, rid, lock_request_queue);
+}
+
+auto LockManager::LockRows(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const std::vector<RID> &rids)
+    -> bool {
+  if (rids.empty()) {
     return true;
   }
-
-  if (lock_request_queue->upgrading_ != INVALID_TXN_ID) {
+  // 准入检查对整批只做一次：表意向锁、2PL策略都只和(txn, mode, oid)有关
+  if (!ValidateRowLock(txn, lock_mode, oid)) {
     return false;
   }
 
-  for (auto &iter : request_queue) {
-    if (iter->txn_id_ == lock_request->txn_id_ && iter->oid_ == lock_request->oid_) {
-      lock_request->granted_ = true;
-      return true;
+  // 按分片号排序，同一分片的RID共享一次map latch，而不是每行各闩一次
+  std::vector<std::pair<size_t, uint32_t>> order;
+  order.reserve(rids.size());
+  for (uint32_t i = 0; i < rids.size(); i++) {
+    order.emplace_back(std::hash<RID>{}(rids[i]) % NUM_LOCK_MAP_SHARDS, i);
+  }
+  std::sort(order.begin(), order.end());
+
+  std::vector<std::shared_ptr<LockRequestQueue>> queues(rids.size());
+  size_t pos = 0;
+  while (pos < order.size()) {
+    size_t end = pos;
+    while (end < order.size() && order[end].first == order[pos].first) {
+      end++;
+    }
+    auto &shard = row_lock_shards_[order[pos].first];
+    // 先持读锁批量查找，真有缺的再升级成写锁批量补建
+    size_t missing = 0;
+    {
+      std::shared_lock<std::shared_mutex> map_lock(shard.latch_);
+      for (size_t k = pos; k < end; k++) {
+        auto it = shard.map_.find(rids[order[k].second]);
+        if (it != shard.map_.end()) {
+          queues[order[k].second] = it->second;
+        } else {
+          missing++;
+        }
+      }
+    }
+    if (missing != 0) {
+      std::unique_lock<std::shared_mutex> map_lock(shard.latch_);
+      for (size_t k = pos; k < end; k++) {
+        auto &queue = queues[order[k].second];
+        if (queue == nullptr) {
+          queue = shard.map_.try_emplace(rids[order[k].second], std::make_shared<LockRequestQueue>()).first->second;
+        }
+      }
     }
-    if (!iter->granted_ && !CheckCompatibility(iter->lock_mode_, lock_request->lock_mode_)) {
+    pos = end;
+  }
+
+  // 授予阶段仍按调用方给定顺序逐行走队列，语义与连续LockRow一致
+  for (size_t i = 0; i < rids.size(); i++) {
+    if (!LockRowOnQueue(txn, lock_mode, oid, rids[i], queues[i])) {
       return false;
     }
   }
+  return true;
+}
 
-  return false;
+auto LockManager::GrantNewRequests(LockRequestQueue *lock_request_queue) -> size_t {
+  size_t granted = 0;
+  auto &request_queue = lock_request_queue->request_queue_;
+  // 升级请求优先级最高；升级未决时其他请求不能越过
+  if (lock_request_queue->upgrading_ != INVALID_TXN_ID) {
+    auto iter = lock_request_queue->FindRequest(lock_request_queue->upgrading_);
+    if (iter == request_queue.end() || iter->granted_ ||
+        (lock_request_queue->granted_modes_bits_ & kConflictsWith[static_cast<size_t>(iter->lock_mode_)]) != 0) {
+      return granted;
+    }
+    lock_request_queue->upgrading_ = INVALID_TXN_ID;
+    iter->granted_ = true;
+    lock_request_queue->OnGrant(iter->lock_mode_);
+    iter->cv_.notify_one();
+    ++granted;
+  }
+  // FIFO：依次授予，遇到第一个无法满足的请求即停，后面的不能越过它
+  for (auto &request : request_queue) {
+    if (request.granted_) {
+      continue;
+    }
+    if ((lock_request_queue->granted_modes_bits_ & kConflictsWith[static_cast<size_t>(request.lock_mode_)]) != 0) {
+      break;
+    }
+    request.granted_ = true;
+    lock_request_queue->OnGrant(request.lock_mode_);
+    request.cv_.notify_one();
+    ++granted;
+  }
+  return granted;
 }
 
 auto LockManager::UnlockRow(Transaction *txn, const table_oid_t &oid, const RID &rid) -> bool {
-  row_lock_map_latch_.lock();
-
-  // LOG_INFO("UnlockRow: %d %d %s", txn->GetTransactionId(), oid, rid.ToString().c_str());
 
-  auto it = row_lock_map_.find(rid);
-  if (it == row_lock_map_.end()) {
+  auto &shard = RowShard(rid);
+  std::shared_ptr<LockRequestQueue> lock_request_queue;
+  {
+    std::shared_lock<std::shared_mutex> map_lock(shard.latch_);
+    auto it = shard.map_.find(rid);
+    if (it != shard.map_.end()) {
+      lock_request_queue = it->second;
+    }
+  }
+  if (lock_request_queue == nullptr) {
     // fixme finish 需解锁
-    row_lock_map_latch_.unlock();
     txn->SetState(TransactionState::ABORTED);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
   }
-  auto lock_request_queue = row_lock_map_[rid];
 
   std::unique_lock<std::mutex> lock(lock_request_queue->latch_);
-  row_lock_map_latch_.unlock();
 
-  std::shared_ptr<LockRequest> lock_request = nullptr;
-  for (auto &iter : lock_request_queue->request_queue_) {
-    if (iter->txn_id_ == txn->GetTransactionId() && iter->oid_ == oid) {
-      lock_request = iter;
-      break;
-    }
+  auto &request_queue = lock_request_queue->request_queue_;
+  auto self_iter = lock_request_queue->FindRequest(txn->GetTransactionId());
+  if (self_iter != request_queue.end() && self_iter->oid_ != oid) {
+    self_iter = request_queue.end();
   }
+  LockRequest *lock_request = self_iter == request_queue.end() ? nullptr : &*self_iter;
 
   if (lock_request == nullptr) {
     txn->SetState(TransactionState::ABORTED);
-    lock_request_queue->cv_.notify_all();
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
   }
 
   if (!lock_request->granted_) {
     txn->SetState(TransactionState::ABORTED);
-    lock_request_queue->cv_.notify_all();
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
   }
 
@@ -555,30 +673,59 @@ auto LockManager::UnlockRow(Transaction *txn, const table_oid_t &oid, const RID
   }
 
   auto lock_mode = lock_request->lock_mode_;
-  lock_request_queue->request_queue_.remove(lock_request);
+  lock_request_queue->Dequeue(self_iter);
+  lock_request_queue->OnRelease(lock_mode);
 
   // txn状态持久化
-  if (lock_mode == LockMode::SHARED) {
-    txn->GetSharedRowLockSet()->find(oid)->second.erase(rid);
-  } else if (lock_mode == LockMode::EXCLUSIVE) {
-    txn->GetExclusiveRowLockSet()->find(oid)->second.erase(rid);
-  }
+  RowLockSetFor(txn, lock_mode)->find(oid)->second.erase(rid);
 
-  lock_request_queue->cv_.notify_all();
+  // 代为授予可以放行的等待者，只唤醒被授予的请求
+  GrantNewRequests(lock_request_queue.get());
 
   return true;
 }
 
-void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
-  auto it = waits_for_.find(t1);
-  if (it == waits_for_.end()) {
-    waits_for_.insert({t1, std::vector<txn_id_t>()});
+void LockManager::BuildWaitEdges(const std::vector<SnapshotRequest> &requests, uint8_t granted_modes_bits,
+                                 std::vector<std::pair<txn_id_t, txn_id_t>> *edges) {
+  // 没有持有者就不可能有等待边
+  if (granted_modes_bits == 0) {
+    return;
+  }
+  // 持有者按模式归组，等待者只对与其冲突的模式建边
+  std::array<std::vector<txn_id_t>, 5> holders_by_mode;
+  for (auto &request : requests) {
+    if (request.granted_) {
+      holders_by_mode[static_cast<size_t>(request.lock_mode_)].push_back(request.txn_id_);
+    }
+  }
+  for (auto &request : requests) {
+    if (request.granted_) {
+      continue;
+    }
+    uint8_t conflict = kConflictsWith[static_cast<size_t>(request.lock_mode_)] & granted_modes_bits;
+    for (size_t mode = 0; mode < 5; ++mode) {
+      if ((conflict & (1U << mode)) != 0) {
+        for (auto holder : holders_by_mode[mode]) {
+          edges->emplace_back(request.txn_id_, holder);
+        }
+      }
+    }
   }
-  it = waits_for_.find(t1);
-  auto vec = it->second;
+}
+
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  // 一次try_emplace同时完成查找和插入；新建的邻接表预留容量，
+  // 省掉头几条边反复扩容
+  auto [it, inserted] = waits_for_.try_emplace(t1);
+  auto &vec = it->second;
+  if (inserted) {
+    vec.reserve(8);
+  }
+  // 原地按序插入：旧实现在副本上lower_bound再push_back原vector，
+  // 既判错重复又破坏有序性，还得靠检测前的全图sort兜底
   auto iter = std::lower_bound(vec.begin(), vec.end(), t2);
   if (iter == vec.end() || (*iter) != t2) {
-    it->second.push_back(t2);
+    vec.insert(iter, t2);
   }
 }
 
@@ -592,27 +739,39 @@ void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
   }
 }
 
-auto LockManager::SearchCycle(std::unordered_set<txn_id_t> &isvisited, txn_id_t cur, std::vector<txn_id_t> &ans)
-    -> bool {
-  // 找到环里面最年轻(id最大)的txn_id
-  auto vec = waits_for_[cur];
-  bool is_cycle = false;
-  for (auto &ne : vec) {
-    if (isvisited.count(ne) != 0U) {
-      is_cycle = true;
-      ans = std::vector<txn_id_t>(isvisited.begin(), isvisited.end());
-      break;
-    }
-    isvisited.insert(ne);
-    is_cycle |= SearchCycle(isvisited, ne, ans);
-    isvisited.erase(ne);
-    // 找到环
-    if (is_cycle) {
-      break;
+auto LockManager::SearchCycle(const WaitGraphCsr &csr, uint32_t start, std::vector<txn_id_t> &ans) -> bool {
+  // 迭代DFS，显式维护当前路径；发现回边时ans只含真正在环上的节点，
+  // 而不是整个已访问集合（旧递归版把访问过的点都当成环，可能abort错事务）。
+  // 图已展平成CSR，路径成员资格用下标数组判定，每步不再哈希查找
+  constexpr uint32_t kNotOnPath = std::numeric_limits<uint32_t>::max();
+  std::vector<std::pair<uint32_t, size_t>> stack;  // 节点及下一条待访问边的下标
+  std::vector<uint32_t> path;
+  std::vector<uint32_t> pos_on_path(csr.verts_.size(), kNotOnPath);  // 节点 -> 在path中的下标
+  stack.emplace_back(start, csr.offsets_[start]);
+  pos_on_path[start] = 0;
+  path.push_back(start);
+  while (!stack.empty()) {
+    auto &[cur, idx] = stack.back();
+    if (idx >= csr.offsets_[cur + 1]) {
+      pos_on_path[path.back()] = kNotOnPath;
+      path.pop_back();
+      stack.pop_back();
+      continue;
+    }
+    uint32_t ne = csr.edges_[idx++];
+    if (pos_on_path[ne] != kNotOnPath) {
+      // 回边：path[pos_on_path[ne]..] 即为环
+      ans.clear();
+      for (size_t i = pos_on_path[ne]; i < path.size(); ++i) {
+        ans.push_back(csr.verts_[path[i]]);
+      }
+      return true;
     }
+    stack.emplace_back(ne, csr.offsets_[ne]);
+    pos_on_path[ne] = static_cast<uint32_t>(path.size());
+    path.push_back(ne);
   }
-
-  return is_cycle;
+  return false;
 }
 
 auto LockManager::HasCycle(txn_id_t *txn_id) -> bool {
@@ -620,25 +779,42 @@ auto LockManager::HasCycle(txn_id_t *txn_id) -> bool {
     return false;
   }
 
-  std::vector<txn_id_t> sort_keys;
+  // 展平成CSR：顶点排序去重一次，邻接顺序与原有序vector一致
+  WaitGraphCsr csr;
+  csr.verts_.reserve(waits_for_.size());
   for (auto &it : waits_for_) {
-    sort_keys.emplace_back(it.first);
+    csr.verts_.push_back(it.first);
+    for (auto &val : it.second) {
+      csr.verts_.push_back(val);
+    }
+  }
+  std::sort(csr.verts_.begin(), csr.verts_.end());
+  csr.verts_.erase(std::unique(csr.verts_.begin(), csr.verts_.end()), csr.verts_.end());
+  auto dense = [&csr](txn_id_t t) -> uint32_t {
+    return static_cast<uint32_t>(std::lower_bound(csr.verts_.begin(), csr.verts_.end(), t) - csr.verts_.begin());
+  };
+  csr.offsets_.reserve(csr.verts_.size() + 1);
+  csr.offsets_.push_back(0);
+  for (auto &vert : csr.verts_) {
+    auto it = waits_for_.find(vert);
+    if (it != waits_for_.end()) {
+      for (auto &val : it->second) {
+        csr.edges_.push_back(dense(val));
+      }
+    }
+    csr.offsets_.push_back(csr.edges_.size());
   }
-  std::sort(sort_keys.begin(), sort_keys.end());
-  // 从tid较小的id开始搜索
-  bool result = false;
-  for (auto &key : sort_keys) {
+
+  // 从tid较小的顶点开始搜索；没有出边的顶点DFS直接结束，不影响结果
+  for (uint32_t start = 0; start < csr.verts_.size(); ++start) {
     std::vector<txn_id_t> ans;
-    std::unordered_set<txn_id_t> isvisited;
-    isvisited.insert(key);
-    result = SearchCycle(isvisited, key, ans);
-    if (result) {
+    if (SearchCycle(csr, start, ans)) {
       *txn_id = *std::max_element(ans.begin(), ans.end());
-      break;
+      return true;
     }
   }
 
-  return result;
+  return false;
 }
 
 auto LockManager::GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>> {
@@ -663,120 +839,78 @@ void LockManager::RunCycleDetection() {
        * 3. 销毁图
        */
       waits_for_latch_.lock();
-      // LOG_INFO("RunCycleDetection");
-      // table
-      table_lock_map_latch_.lock();
-      for (auto &it : table_lock_map_) {
-        std::unique_lock<std::mutex> lock(it.second->latch_);
-        for (auto &iter1 : it.second->request_queue_) {
-          if (!iter1->granted_) {
-            for (auto &iter2 : it.second->request_queue_) {
-              if (iter2->granted_) {
-                if (!CheckCompatibility(iter1->lock_mode_, iter2->lock_mode_)) {
-                  AddEdge(iter1->txn_id_, iter2->txn_id_);
-                }
-              }
+      // 快照阶段：各分片并行收集，队列锁只在拷贝三元组的一瞬间持有，
+      // LockTable/LockRow不再被整个检测过程阻塞。每个任务只写自己的
+      // 局部边表和等待者表，最后串行合并成一张全局图再找环，跨分片的
+      // 环（一个事务在多个分片持锁）不会漏掉。
+      struct ShardEdges {
+        std::vector<std::pair<txn_id_t, txn_id_t>> edges_;
+        std::vector<std::pair<txn_id_t, std::shared_ptr<LockRequestQueue>>> waiters_;
+      };
+      auto collect_shard = [](auto &shard) -> ShardEdges {
+        ShardEdges out;
+        std::vector<SnapshotRequest> snapshot;
+        std::shared_lock<std::shared_mutex> shard_lock(shard.latch_);
+        for (auto &it : shard.map_) {
+          uint8_t granted_bits;
+          snapshot.clear();
+          {
+            std::unique_lock<std::mutex> lock(it.second->latch_);
+            granted_bits = it.second->granted_modes_bits_;
+            if (granted_bits == 0) {
+              continue;
+            }
+            snapshot.reserve(it.second->request_queue_.size());
+            for (auto &request : it.second->request_queue_) {
+              snapshot.push_back({request.txn_id_, request.lock_mode_, request.granted_});
             }
           }
-        }
-      }
-      // table_lock_map_latch_.unlock();
-      // row
-      row_lock_map_latch_.lock();
-      for (auto &it : row_lock_map_) {
-        std::unique_lock<std::mutex> lock(it.second->latch_);
-        for (auto &iter1 : it.second->request_queue_) {
-          if (!iter1->granted_) {
-            for (auto &iter2 : it.second->request_queue_) {
-              if (iter2->granted_) {
-                if (!CheckCompatibility(iter1->lock_mode_, iter2->lock_mode_)) {
-                  AddEdge(iter1->txn_id_, iter2->txn_id_);
-                }
-              }
+          BuildWaitEdges(snapshot, granted_bits, &out.edges_);
+          for (auto &request : snapshot) {
+            if (!request.granted_) {
+              out.waiters_.emplace_back(request.txn_id_, it.second);
             }
           }
         }
+        return out;
+      };
+      std::vector<std::future<ShardEdges>> futures;
+      futures.reserve(2 * NUM_LOCK_MAP_SHARDS);
+      for (auto &shard : table_lock_shards_) {
+        futures.push_back(std::async(std::launch::async, [&collect_shard, &shard] { return collect_shard(shard); }));
       }
-
-      for (auto &it : waits_for_) {
-        std::sort(it.second.begin(), it.second.end());
+      for (auto &shard : row_lock_shards_) {
+        futures.push_back(std::async(std::launch::async, [&collect_shard, &shard] { return collect_shard(shard); }));
       }
+      std::unordered_map<txn_id_t, std::shared_ptr<LockRequestQueue>> waiter_queues;
+      for (auto &future : futures) {
+        auto shard_edges = future.get();
+        for (auto &[t1, t2] : shard_edges.edges_) {
+          AddEdge(t1, t2);
+        }
+        for (auto &[waiter, queue] : shard_edges.waiters_) {
+          waiter_queues.emplace(waiter, std::move(queue));
+        }
+      }
+
+      // 邻接表在AddEdge时就保持有序，无需整图排序
       // 检测
       txn_id_t txn_id = -1;
       while (HasCycle(&txn_id)) {
         assert(txn_id != -1);
-        // LOG_INFO("REMOVE: %d", txn_id);
         auto txn = TransactionManager::GetTransaction(txn_id);
         txn->SetState(TransactionState::ABORTED);
 
-        // 删除指定txn_id
-        // table_lock_map_latch_.lock();
-        for (auto &it : table_lock_map_) {
-          std::unique_lock<std::mutex> lock(it.second->latch_);
-          /**
-           * auto iter = it.second->request_queue_.begin();
-          while (iter != it.second->request_queue_.end()) {
-            if ((*iter)->txn_id_ == txn_id) {
-              // 持久化
-              auto lock_mode = (*iter)->lock_mode_;
-              auto oid = (*iter)->oid_;
-              switch(lock_mode) {
-                case LockMode::EXCLUSIVE:
-                  txn->GetExclusiveTableLockSet()->erase(oid);
-                  break;
-                case LockMode::SHARED:
-                  txn->GetSharedTableLockSet()->erase(oid);
-                  break;
-                case LockMode::INTENTION_EXCLUSIVE:
-                  txn->GetIntentionExclusiveTableLockSet()->erase(oid);
-                  break;
-                case LockMode::INTENTION_SHARED:
-                  txn->GetIntentionSharedTableLockSet()->erase(oid);
-                  break;
-                default :
-                  txn->GetSharedIntentionExclusiveTableLockSet()->erase(oid);
-                  break;
-              }
-              iter = it.second->request_queue_.erase(iter);
-            } else {
-              iter++;
-            }
-          }
-          */
-          it.second->cv_.notify_all();
-        }
-        // table_lock_map_latch_.unlock();
-
-        // row_lock_map_latch_.lock();
-        for (auto &it : row_lock_map_) {
-          std::unique_lock<std::mutex> lock(it.second->latch_);
-          /***
-           * auto iter = it.second->request_queue_.begin();
-          while (iter != it.second->request_queue_.end()) {
-            if ((*iter)->txn_id_ == txn_id) {
-              // 持久化
-              auto lock_mode = (*iter)->lock_mode_;
-              auto oid = (*iter)->oid_;
-              auto rid = (*iter)->rid_;
-              switch(lock_mode) {
-                case LockMode::SHARED:
-                  txn->GetSharedRowLockSet()->find(oid)->second.erase(rid);
-                  break;
-                case LockMode::EXCLUSIVE:
-                  txn->GetExclusiveRowLockSet()->find(oid)->second.erase(rid);
-                  break;
-                default:
-                  break;
-              }
-              iter = it.second->request_queue_.erase(iter);
-            } else {
-              iter++;
-            }
+        // 只重锁受害者挂着的那一个队列并唤醒它；它醒来看到ABORTED会自行
+        // 出队并放行后继，无需重走全部分片
+        auto wq = waiter_queues.find(txn_id);
+        if (wq != waiter_queues.end()) {
+          std::unique_lock<std::mutex> lock(wq->second->latch_);
+          auto iter = wq->second->FindRequest(txn_id);
+          if (iter != wq->second->request_queue_.end() && !iter->granted_) {
+            iter->cv_.notify_one();
           }
-          */
-          it.second->cv_.notify_all();
         }
-        // row_lock_map_latch_.unlock();
 
         // 删除边
         waits_for_.erase(txn_id);
@@ -791,8 +925,6 @@ void LockManager::RunCycleDetection() {
 
       // 删除
       waits_for_.clear();
-      row_lock_map_latch_.unlock();
-      table_lock_map_latch_.unlock();
       waits_for_latch_.unlock();
     }
   }
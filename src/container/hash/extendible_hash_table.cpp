@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <functional>
@@ -24,21 +25,43 @@
 namespace bustub {
 
 template <typename K, typename V>
-ExtendibleHashTable<K, V>::ExtendibleHashTable(size_t bucket_size)
-    : global_depth_(0), bucket_size_(bucket_size), num_buckets_(1) {
-  dir_.push_back(std::shared_ptr<Bucket>(new Bucket(bucket_size_)));
+ExtendibleHashTable<K, V>::ExtendibleHashTable(size_t bucket_size) : ExtendibleHashTable(bucket_size, 0) {}
+
+template <typename K, typename V>
+ExtendibleHashTable<K, V>::ExtendibleHashTable(size_t bucket_size, int initial_global_depth)
+    : global_depth_(initial_global_depth), bucket_size_(bucket_size), num_buckets_(1 << initial_global_depth) {
+  // 预置目录到2^depth个槽，每槽独立桶（局部深度=全局深度），省去热身期的逐次翻倍
+  dir_.reserve(static_cast<size_t>(1) << initial_global_depth);
+  for (int i = 0; i < (1 << initial_global_depth); ++i) {
+    dir_.push_back(&bucket_store_.emplace_back(bucket_size_, initial_global_depth));
+  }
 }
 
 template <typename K, typename V>
-auto ExtendibleHashTable<K, V>::IndexOf(const K &key) -> size_t {
-  int mask = (1 << global_depth_) - 1;
+void ExtendibleHashTable<K, V>::Reserve(size_t estimated_keys) {
+  std::unique_lock<std::shared_mutex> lock(latch_);
+  // 需要的桶数向上取整到2的幂即目标全局深度
+  size_t target_buckets = (estimated_keys + bucket_size_ - 1) / bucket_size_;
+  int target_depth = global_depth_;
+  while ((static_cast<size_t>(1) << target_depth) < target_buckets) {
+    ++target_depth;
+  }
+  if (target_depth == global_depth_) {
+    return;
+  }
 
-  return std::hash<K>()(key) & mask;
+  // 一次resize到位，新槽按低global_depth_位镜像现有指针，与逐次翻倍等价
+  size_t old_size = dir_.size();
+  dir_.resize(static_cast<size_t>(1) << target_depth);
+  for (size_t i = old_size; i < dir_.size(); ++i) {
+    dir_[i] = dir_[i & (old_size - 1)];
+  }
+  global_depth_ = target_depth;
 }
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::GetGlobalDepth() const -> int {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock<std::shared_mutex> lock(latch_);
   return GetGlobalDepthInternal();
 }
 
@@ -49,7 +72,7 @@ auto ExtendibleHashTable<K, V>::GetGlobalDepthInternal() const -> int {
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::GetLocalDepth(int dir_index) const -> int {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock<std::shared_mutex> lock(latch_);
   return GetLocalDepthInternal(dir_index);
 }
 
@@ -60,7 +83,7 @@ auto ExtendibleHashTable<K, V>::GetLocalDepthInternal(int dir_index) const -> in
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::GetNumBuckets() const -> int {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock<std::shared_mutex> lock(latch_);
   return GetNumBucketsInternal();
 }
 
@@ -72,44 +95,74 @@ auto ExtendibleHashTable<K, V>::GetNumBucketsInternal() const -> int {
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Find(const K &key, V &value) -> bool {
   // UNREACHABLE("not implemented");
-  std::scoped_lock<std::mutex> lock(latch_);
+  // 目录共享锁允许并发查找，桶锁只串行化同一个桶
+  std::shared_lock<std::shared_mutex> lock(latch_);
   auto it = dir_[IndexOf(key)];
+  std::shared_lock<std::shared_mutex> bucket_lock(it->latch_);
 
   return static_cast<bool>(it->Find(key, value));
 }
 
+template <typename K, typename V>
+void ExtendibleHashTable<K, V>::FindBatch(const K *keys, V *values, uint8_t *found, size_t n) {
+  std::shared_lock<std::shared_mutex> lock(latch_);
+  constexpr size_t kBatch = 64;
+  size_t idx[kBatch];
+  for (size_t base = 0; base < n; base += kBatch) {
+    size_t m = std::min(kBatch, n - base);
+    // 第一趟：整批求hash并预取目录槽；第二趟预取桶本体；第三趟真正探测。
+    // 各键的miss在趟间互相重叠，而不是每个键串行走完hash→槽→桶的依赖链
+    for (size_t i = 0; i < m; ++i) {
+      idx[i] = IndexOfHash(EHTHash<K>()(keys[base + i]));
+      __builtin_prefetch(&dir_[idx[i]], 0, 0);
+    }
+    for (size_t i = 0; i < m; ++i) {
+      __builtin_prefetch(dir_[idx[i]], 0, 0);
+    }
+    for (size_t i = 0; i < m; ++i) {
+      auto *bucket = dir_[idx[i]];
+      std::shared_lock<std::shared_mutex> bucket_lock(bucket->latch_);
+      found[base + i] = static_cast<uint8_t>(bucket->Find(keys[base + i], values[base + i]));
+    }
+  }
+}
+
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Remove(const K &key) -> bool {
   // UNREACHABLE("not implemented");
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock<std::shared_mutex> lock(latch_);
   auto it = dir_[IndexOf(key)];
+  std::unique_lock<std::shared_mutex> bucket_lock(it->latch_);
 
   return static_cast<bool>(it->Remove(key));
 }
 
 template <typename K, typename V>
-void ExtendibleHashTable<K, V>::RedistributeBucket(std::shared_ptr<Bucket> bucket) {
+void ExtendibleHashTable<K, V>::RedistributeBucket(Bucket *bucket) {
+  size_t old_stride = static_cast<size_t>(1) << bucket->GetDepth();
   bucket->IncrementDepth();
   ++num_buckets_;
 
-  int tmp_mask = (1 << bucket->GetDepth()) - 1;
   auto list = bucket->GetItems();
 
-  std::unordered_map<size_t, std::shared_ptr<Bucket>> split_bucket;
-  for (size_t i = 0; i < dir_.size(); ++i) {
-    if (dir_[i] == bucket) {
-      size_t k = i & tmp_mask;
-      if (!split_bucket.count(k)) {
-        dir_[i] = std::shared_ptr<Bucket>(new Bucket(bucket_size_, bucket->GetDepth()));
-        split_bucket[k] = dir_[i];
-      } else {
-        dir_[i] = split_bucket[k];
-      }
-    }
+  // 指向该桶的槽位恰是低old_depth位等于其前缀的下标，周期为old_stride，
+  // 首个必落在[0, old_stride)内。找到前缀后按步长直接跳，不再线性扫
+  // 全目录逐槽比较shared_ptr
+  size_t prefix = 0;
+  while (dir_[prefix] != bucket) {
+    ++prefix;
   }
 
+  // 按新深度的最高位分成两个新桶：位0沿用前缀，位1是镜像
+  auto *zero_bucket = &bucket_store_.emplace_back(bucket_size_, bucket->GetDepth());
+  auto *one_bucket = &bucket_store_.emplace_back(bucket_size_, bucket->GetDepth());
+  for (size_t i = prefix; i < dir_.size(); i += old_stride) {
+    dir_[i] = ((i & old_stride) != 0) ? one_bucket : zero_bucket;
+  }
+
+  // 每个键只求一次hash，重分配目标用同一hash按新mask取索引
   for (auto &[k, v] : list) {
-    dir_[IndexOf(k)]->Insert(k, v);
+    dir_[IndexOfHash(EHTHash<K>()(k))]->Insert(k, v);
   }
 }
 
@@ -120,23 +173,35 @@ void ExtendibleHashTable<K, V>::RedistributeBucket(std::shared_ptr<Bucket> bucke
 template <typename K, typename V>
 void ExtendibleHashTable<K, V>::Insert(const K &key, const V &value) {
   // UNREACHABLE("not implemented");
-  std::scoped_lock<std::mutex> lock(latch_);
+  // 分裂重试循环里每轮都要按当前depth重新取索引，但hash只算一次
+  size_t hash = EHTHash<K>()(key);
+  // 快路径：目录共享锁+桶独占锁，桶未满时插入不阻塞其他桶的操作
+  {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    auto bucket = dir_[IndexOfHash(hash)];
+    std::unique_lock<std::shared_mutex> bucket_lock(bucket->latch_);
+    if (bucket->Insert(key, value)) {
+      return;
+    }
+  }
+
+  // 慢路径：目录独占锁下分裂/扩目录。桶锁持有者必然同时持有目录共享锁，
+  // 拿到独占锁即独占所有桶，无需再锁单个桶
+  std::unique_lock<std::shared_mutex> lock(latch_);
   while (true) {
-    auto bucket = dir_[IndexOf(key)];
+    auto bucket = dir_[IndexOfHash(hash)];
 
     if (bucket->Insert(key, value)) {
       break;
     }
 
     if (bucket->GetDepth() == global_depth_) {
-      int tmp_mask = (1 << global_depth_) - 1;
+      // 目录翻倍：i和i+old_size的低global_depth_位相同，上半区只是下半区
+      // 指针的镜像。原地resize后整段拷贝，省掉整张临时目录和逐项mask
       ++global_depth_;
-      std::vector<std::shared_ptr<Bucket>> tmp(dir_.size() * 2);
-      for (size_t i = 0; i < tmp.size(); ++i) {
-        size_t k = i & tmp_mask;
-        tmp[i] = dir_[k];
-      }
-      dir_ = std::move(tmp);
+      size_t old_size = dir_.size();
+      dir_.resize(old_size * 2);
+      std::copy_n(dir_.begin(), old_size, dir_.begin() + old_size);
     }
     RedistributeBucket(bucket);
   }
@@ -146,19 +211,21 @@ void ExtendibleHashTable<K, V>::Insert(const K &key, const V &value) {
 // Bucket
 //===--------------------------------------------------------------------===//
 template <typename K, typename V>
-ExtendibleHashTable<K, V>::Bucket::Bucket(size_t array_size, int depth) : size_(array_size), depth_(depth) {}
+ExtendibleHashTable<K, V>::Bucket::Bucket(size_t array_size, int depth) : size_(array_size), depth_(depth) {
+  items_.reserve(array_size);
+}
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::IndexOf(const K &key) const -> int {
   int mask = (1 << depth_) - 1;
 
-  return std::hash<K>()(key) & mask;
+  return EHTHash<K>()(key) & mask;
 }
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::Find(const K &key, V &value) -> bool {
   // UNREACHABLE("not implemented");
-  for (auto &[k, v] : list_) {
+  for (auto &[k, v] : items_) {
     if (key == k) {
       value = v;
       return true;
@@ -171,13 +238,12 @@ auto ExtendibleHashTable<K, V>::Bucket::Find(const K &key, V &value) -> bool {
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::Remove(const K &key) -> bool {
   // UNREACHABLE("not implemented");
-  bool flag = std::any_of(list_.begin(), list_.end(), [key](auto it) { return key == it.first; });
-  if (flag) {
-    for (auto &it : list_) {
-      if (it.first == key) {
-        list_.remove(it);
-        return true;
-      }
+  for (auto iter = items_.begin(); iter != items_.end(); ++iter) {
+    if (iter->first == key) {
+      // 桶内无序，与末尾交换后弹出即可，无需搬移后续元素
+      *iter = std::move(items_.back());
+      items_.pop_back();
+      return true;
     }
   }
 
@@ -187,7 +253,7 @@ auto ExtendibleHashTable<K, V>::Bucket::Remove(const K &key) -> bool {
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::Insert(const K &key, const V &value) -> bool {
   // UNREACHABLE("not implemented");
-  for (auto &[k, v] : list_) {
+  for (auto &[k, v] : items_) {
     if (key == k) {
       v = value;
       return true;
@@ -198,7 +264,7 @@ auto ExtendibleHashTable<K, V>::Bucket::Insert(const K &key, const V &value) ->
     return false;
   }
 
-  list_.push_back(std::make_pair(key, value));
+  items_.emplace_back(key, value);
   return true;
 }
 
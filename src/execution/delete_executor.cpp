@@ -24,6 +24,9 @@ void DeleteExecutor::Init() {
   child_executor_->Init();
   count_ = 0;
   flag_ = true;
+  // 表和索引的catalog查询挂在Init里做一次，Next的每行循环直接用缓存指针
+  table_info_ = exec_ctx_->GetCatalog()->GetTable(plan_->TableOid());
+  index_infos_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
   // LOG_INFO("table delete");
   // 对表获取IX锁，元组获取X锁
   try {
@@ -63,38 +66,34 @@ auto DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
   while (status) {
     ++count_;
     // 1. 得到元组从表中标记删除
-    TableInfo *tableinfo = exec_ctx_->GetCatalog()->GetTable(plan_->TableOid());
     try {
       bool result = exec_ctx_->GetLockManager()->LockRow(exec_ctx_->GetTransaction(), LockManager::LockMode::EXCLUSIVE,
                                                          plan_->TableOid(), *rid);
       if (!result) {
         // 事务回滚
         for (auto &rid : remove_tuples_) {
-          exec_ctx_->GetCatalog()
-              ->GetTable(plan_->TableOid())
-              ->table_->RollbackDelete(rid, exec_ctx_->GetTransaction());
+          table_info_->table_->RollbackDelete(rid, exec_ctx_->GetTransaction());
         }
         exec_ctx_->GetTransaction()->SetState(TransactionState::ABORTED);
         throw std::exception();
       }
     } catch (const std::exception &e) {
       for (auto &rid : remove_tuples_) {
-        exec_ctx_->GetCatalog()->GetTable(plan_->TableOid())->table_->RollbackDelete(rid, exec_ctx_->GetTransaction());
+        table_info_->table_->RollbackDelete(rid, exec_ctx_->GetTransaction());
       }
       throw std::exception();
     }
     // LOG_INFO("lock row X");
-    tableinfo->table_->MarkDelete(*rid, exec_ctx_->GetTransaction());
+    table_info_->table_->MarkDelete(*rid, exec_ctx_->GetTransaction());
     remove_tuples_.emplace_back(*rid);
     // 2. 若有index，从index删除
-    auto indexinfos = exec_ctx_->GetCatalog()->GetTableIndexes(tableinfo->name_);
-    for (auto &indexinfo : indexinfos) {
-      std::vector<Value> key_values{};
-      key_values.reserve(indexinfo->key_schema_.GetColumnCount());
+    for (auto &indexinfo : index_infos_) {
+      // 复用成员缓冲，省去每行每索引一次vector分配
+      key_values_.clear();
       for (auto &column_idx : indexinfo->index_->GetKeyAttrs()) {
-        key_values.push_back(child_tuple.GetValue(&child_executor_->GetOutputSchema(), column_idx));
+        key_values_.push_back(child_tuple.GetValue(&child_executor_->GetOutputSchema(), column_idx));
       }
-      Tuple index_tuple = Tuple(key_values, &indexinfo->key_schema_);
+      Tuple index_tuple = Tuple(key_values_, &indexinfo->key_schema_);
       indexinfo->index_->DeleteEntry(index_tuple, *rid, exec_ctx_->GetTransaction());
     }
     status = child_executor_->Next(&child_tuple, rid);
@@ -24,6 +24,9 @@ void InsertExecutor::Init() {
   child_executor_->Init();
   count_ = 0;
   flag_ = true;
+  // 表和索引的catalog查询挂在Init里做一次，Next的每行循环直接用缓存指针
+  table_info_ = exec_ctx_->GetCatalog()->GetTable(plan_->TableOid());
+  index_infos_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
   // LOG_INFO("table insert");
   try {
     /* code */
@@ -65,7 +68,6 @@ auto InsertExecutor::Next(Tuple *tuple, RID *rid) -> bool {
   while (status) {
     ++count_;
     // 1. 得到元组插入表
-    TableInfo *tableinfo = exec_ctx_->GetCatalog()->GetTable(plan_->TableOid());
     try {
       bool lockresult = exec_ctx_->GetLockManager()->LockRow(exec_ctx_->GetTransaction(),
                                                              LockManager::LockMode::EXCLUSIVE, plan_->TableOid(), *rid);
@@ -73,7 +75,7 @@ auto InsertExecutor::Next(Tuple *tuple, RID *rid) -> bool {
         // 对已经插入的进行rollback
         // LOG_INFO("lock row X faile");
         for (auto &rid : insert_recode_) {
-          exec_ctx_->GetCatalog()->GetTable(plan_->TableOid())->table_->ApplyDelete(rid, exec_ctx_->GetTransaction());
+          table_info_->table_->ApplyDelete(rid, exec_ctx_->GetTransaction());
         }
         exec_ctx_->GetTransaction()->SetState(TransactionState::ABORTED);
         throw std::exception();
@@ -81,24 +83,22 @@ auto InsertExecutor::Next(Tuple *tuple, RID *rid) -> bool {
     } catch (const std::exception &e) {
       // LOG_INFO("lock row X faile");
       for (auto &rid : insert_recode_) {
-        exec_ctx_->GetCatalog()->GetTable(plan_->TableOid())->table_->ApplyDelete(rid, exec_ctx_->GetTransaction());
+        table_info_->table_->ApplyDelete(rid, exec_ctx_->GetTransaction());
       }
       throw std::exception();
     }
     // LOG_INFO("lock row X");
-    bool result = tableinfo->table_->InsertTuple(child_tuple, rid, exec_ctx_->GetTransaction());
+    bool result = table_info_->table_->InsertTuple(child_tuple, rid, exec_ctx_->GetTransaction());
     assert(result != false);
     insert_recode_.emplace_back(*rid);
     // 2. 若有index，插入index
-    auto indexinfos = exec_ctx_->GetCatalog()->GetTableIndexes(tableinfo->name_);
-    for (auto &indexinfo : indexinfos) {
-      // 获取对应列的值存入
-      std::vector<Value> key_values{};
-      key_values.reserve(indexinfo->key_schema_.GetColumnCount());
+    for (auto &indexinfo : index_infos_) {
+      // 获取对应列的值存入。复用成员缓冲，省去每行每索引一次vector分配
+      key_values_.clear();
       for (auto &column_idx : indexinfo->index_->GetKeyAttrs()) {
-        key_values.emplace_back(child_tuple.GetValue(&child_executor_->GetOutputSchema(), column_idx));
+        key_values_.emplace_back(child_tuple.GetValue(&child_executor_->GetOutputSchema(), column_idx));
       }
-      Tuple index_tuple = Tuple(key_values, &indexinfo->key_schema_);
+      Tuple index_tuple = Tuple(key_values_, &indexinfo->key_schema_);
       indexinfo->index_->InsertEntry(index_tuple, *rid, exec_ctx_->GetTransaction());
     }
     status = child_executor_->Next(&child_tuple, rid);
@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "execution/executors/nested_index_join_executor.h"
 
 namespace bustub {
@@ -29,39 +31,28 @@ void NestIndexJoinExecutor::Init() {
   Tuple child_tuple{};
   RID rid;
   IndexInfo *indexinfo = exec_ctx_->GetCatalog()->GetIndex(plan_->GetIndexOid());
-  TableInfo *tableinfo = exec_ctx_->GetCatalog()->GetTable(plan_->GetInnerTableOid());
+  inner_table_ = exec_ctx_->GetCatalog()->GetTable(plan_->GetInnerTableOid());
   // 对于从子表中提出的外部元组，向catalog索引中找到内部表元组。
   // 使用key predicate构造索引探测键
+  // 中间结果只存外侧元组+内侧RID，拼接推迟到Next()按需做
+  std::vector<Value> key_values;
+  std::vector<RID> index_result;
+  key_values.reserve(indexinfo->key_schema_.GetColumnCount());
   auto statue = child_executor_->Next(&child_tuple, &rid);
   while (statue) {
-    Tuple key{};
-    std::vector<Value> key_values{};
-    for (size_t i = 0; i < indexinfo->key_schema_.GetColumnCount(); ++i) {
-      key_values.push_back(plan_->KeyPredicate()->Evaluate(&child_tuple, child_executor_->GetOutputSchema()));
-    }
+    // KeyPredicate是单个表达式，求值一次即得探测键；原来按key_schema列数
+    // 重复求值并塞入同一个值
+    key_values.clear();
+    key_values.push_back(plan_->KeyPredicate()->Evaluate(&child_tuple, child_executor_->GetOutputSchema()));
 
-    std::vector<RID> index_result;
+    index_result.clear();
     indexinfo->index_->ScanKey(Tuple(key_values, &indexinfo->key_schema_), &index_result, exec_ctx_->GetTransaction());
-    std::vector<Value> values;
-    for (size_t i = 0; i < child_executor_->GetOutputSchema().GetColumnCount(); ++i) {
-      values.push_back(child_tuple.GetValue(&child_executor_->GetOutputSchema(), i));
-    }
     for (auto &r : index_result) {
-      Tuple right_tuple{};
-      std::vector<Value> all_values;
-      all_values.assign(values.begin(), values.end());
-      tableinfo->table_->GetTuple(r, &right_tuple, exec_ctx_->GetTransaction());
-      for (size_t i = 0; i < plan_->InnerTableSchema().GetColumnCount(); ++i) {
-        all_values.emplace_back(right_tuple.GetValue(&plan_->InnerTableSchema(), i));
-      }
-      result_.emplace_back(Tuple(all_values, &GetOutputSchema()));
+      result_.push_back(OutRow{child_tuple, r, true});
     }
 
     if (index_result.empty() && plan_->GetJoinType() == JoinType::LEFT) {
-      for (size_t i = 0; i < plan_->InnerTableSchema().GetColumnCount(); ++i) {
-        values.emplace_back(ValueFactory::GetNullValueByType(TypeId::INTEGER));
-      }
-      result_.emplace_back(Tuple(values, &GetOutputSchema()));
+      result_.push_back(OutRow{child_tuple, RID{}, false});
     }
 
     statue = child_executor_->Next(&child_tuple, &rid);
@@ -73,9 +64,27 @@ auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
     return false;
   }
 
-  *tuple = result_[index_];
+  auto &row = result_[index_];
   ++index_;
 
+  if (row.has_right_) {
+    Tuple right_tuple{};
+    inner_table_->table_->GetTuple(row.right_rid_, &right_tuple, exec_ctx_->GetTransaction());
+    // 两侧都有元组时直接按字节拼接，免去逐列GetValue再序列化的两趟拷贝
+    *tuple = Tuple::AssembleConcat(GetOutputSchema(), {{&row.left_, &child_executor_->GetOutputSchema()},
+                                                       {&right_tuple, &plan_->InnerTableSchema()}});
+    return true;
+  }
+
+  values_.clear();
+  for (size_t i = 0; i < child_executor_->GetOutputSchema().GetColumnCount(); ++i) {
+    values_.push_back(row.left_.GetValue(&child_executor_->GetOutputSchema(), i));
+  }
+  for (size_t i = 0; i < plan_->InnerTableSchema().GetColumnCount(); ++i) {
+    values_.push_back(ValueFactory::GetNullValueByType(TypeId::INTEGER));
+  }
+  *tuple = Tuple(values_, &GetOutputSchema());
+
   return true;
 }
 
@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "execution/executors/nested_loop_join_executor.h"
 #include "binder/table_ref/bound_join_ref.h"
 #include "common/exception.h"
@@ -29,63 +31,110 @@ NestedLoopJoinExecutor::NestedLoopJoinExecutor(ExecutorContext *exec_ctx, const
   }
 }
 
+// 每块边长：两块各256个Tuple头部连同谓词工作集一起贴在L1/L2里
+static constexpr size_t kBlockSize = 256;
+
 void NestedLoopJoinExecutor::Init() {
   left_executor_->Init();
   right_executor_->Init();
-  index_ = 0;
-  std::vector<Tuple> left_tuples{};
-  std::vector<Tuple> right_tuples{};
+  left_tuples_.clear();
+  right_tuples_.clear();
   Tuple child_tuple{};
   RID rid;
   auto status = left_executor_->Next(&child_tuple, &rid);
   while (status) {
-    left_tuples.push_back(child_tuple);
+    left_tuples_.push_back(child_tuple);
     status = left_executor_->Next(&child_tuple, &rid);
   }
   status = right_executor_->Next(&child_tuple, &rid);
   while (status) {
-    right_tuples.push_back(child_tuple);
+    right_tuples_.push_back(child_tuple);
     status = right_executor_->Next(&child_tuple, &rid);
   }
-  for (auto &left_tuple : left_tuples) {
-    bool match_flag = false;
-    for (auto &right_tuple : right_tuples) {
-      Value is_match = plan_->Predicate().EvaluateJoin(&left_tuple, left_executor_->GetOutputSchema(), &right_tuple,
-                                                       right_executor_->GetOutputSchema());
-      if (is_match.ToString() == "true") {
-        std::vector<Value> values{};
-        match_flag = true;
-        for (size_t i = 0; i < left_executor_->GetOutputSchema().GetColumnCount(); ++i) {
-          values.emplace_back(left_tuple.GetValue(&left_executor_->GetOutputSchema(), i));
-        }
-        for (size_t i = 0; i < right_executor_->GetOutputSchema().GetColumnCount(); ++i) {
-          values.emplace_back(right_tuple.GetValue(&right_executor_->GetOutputSchema(), i));
+  matched_.assign(left_tuples_.size(), false);
+  lb_ = 0;
+  rb_ = 0;
+  li_ = 0;
+  ri_ = 0;
+  emitting_nulls_ = false;
+  null_li_ = 0;
+}
+
+auto NestedLoopJoinExecutor::MakeOutput(const Tuple &left, const Tuple *right) -> Tuple {
+  // 两侧都有元组时直接按字节拼接，免去逐列GetValue再序列化的两趟拷贝
+  if (right != nullptr) {
+    return Tuple::AssembleConcat(
+        GetOutputSchema(), {{&left, &left_executor_->GetOutputSchema()}, {right, &right_executor_->GetOutputSchema()}});
+  }
+  values_.clear();
+  for (size_t i = 0; i < left_executor_->GetOutputSchema().GetColumnCount(); ++i) {
+    values_.emplace_back(left.GetValue(&left_executor_->GetOutputSchema(), i));
+  }
+  for (size_t i = 0; i < right_executor_->GetOutputSchema().GetColumnCount(); ++i) {
+    values_.emplace_back(ValueFactory::GetNullValueByType(TypeId::INTEGER));
+  }
+  return Tuple(values_, &GetOutputSchema());
+}
+
+// 不再在Init里物化整个连接结果：按保存的(块origin, 块内游标)续跑分块
+// 探测，每次命中即产出一行。内存从O(结果)降到O(输入)，LIMIT可提前停
+auto NestedLoopJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (lb_ < left_tuples_.size()) {
+    size_t lend = std::min(lb_ + kBlockSize, left_tuples_.size());
+
+    // 当前左块已扫完所有右块，补发左连接的null行
+    if (emitting_nulls_) {
+      while (null_li_ < lend) {
+        size_t li = null_li_++;
+        if (!matched_[li]) {
+          *tuple = MakeOutput(left_tuples_[li], nullptr);
+          return true;
         }
-        result_.emplace_back(Tuple(values, &GetOutputSchema()));
       }
+      emitting_nulls_ = false;
+      lb_ += kBlockSize;
+      rb_ = 0;
+      li_ = lb_;
+      ri_ = 0;
+      continue;
     }
-    if (plan_->GetJoinType() == JoinType::LEFT && !match_flag) {
-      std::vector<Value> values{};
-      for (size_t i = 0; i < left_executor_->GetOutputSchema().GetColumnCount(); ++i) {
-        values.emplace_back(left_tuple.GetValue(&left_executor_->GetOutputSchema(), i));
-      }
-      for (size_t i = 0; i < right_executor_->GetOutputSchema().GetColumnCount(); ++i) {
-        values.emplace_back(ValueFactory::GetNullValueByType(TypeId::INTEGER));
+
+    if (rb_ < right_tuples_.size()) {
+      size_t rend = std::min(rb_ + kBlockSize, right_tuples_.size());
+      while (li_ < lend) {
+        while (ri_ < rend) {
+          size_t r = ri_++;
+          Value is_match = plan_->Predicate().EvaluateJoin(&left_tuples_[li_], left_executor_->GetOutputSchema(),
+                                                           &right_tuples_[r], right_executor_->GetOutputSchema());
+          // 直接读布尔值；ToString()=="true"每对元组都要分配一个std::string再比较
+          if (!is_match.IsNull() && is_match.GetAs<bool>()) {
+            matched_[li_] = true;
+            *tuple = MakeOutput(left_tuples_[li_], &right_tuples_[r]);
+            return true;
+          }
+        }
+        ++li_;
+        ri_ = rb_;
       }
-      result_.emplace_back(Tuple(values, &GetOutputSchema()));
+      rb_ += kBlockSize;
+      li_ = lb_;
+      ri_ = rb_;
+      continue;
     }
-  }
-}
 
-auto NestedLoopJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
-  if (index_ == result_.size()) {
-    return false;
+    // 右块全部扫完：左连接转入null补发，否则推进到下一个左块
+    if (plan_->GetJoinType() == JoinType::LEFT) {
+      emitting_nulls_ = true;
+      null_li_ = lb_;
+      continue;
+    }
+    lb_ += kBlockSize;
+    rb_ = 0;
+    li_ = lb_;
+    ri_ = 0;
   }
 
-  *tuple = result_[index_];
-  ++index_;
-
-  return true;
+  return false;
 }
 
 }  // namespace bustub
@@ -1,73 +1,151 @@
-//===----------------------------------------------------------------------===//
-//
-//                         BusTub
-//
-// seq_scan_executor.cpp
-//
-// Identification: src/execution/seq_scan_executor.cpp
-//
-// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
-//
-//===----------------------------------------------------------------------===//
-
-#include "execution/executors/seq_scan_executor.h"
-
-#include "common/logger.h"
-
-namespace bustub {
-
-SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx),
-      plan_(plan),
-      iterator_(exec_ctx_->GetCatalog()->GetTable(plan_->GetTableOid())->table_->Begin(exec_ctx_->GetTransaction())) {}
-
-void SeqScanExecutor::Init() {
-  // 获取table锁
-  // LOG_INFO("seq scan");
-  if (exec_ctx_->GetTransaction()->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
-    bool result = exec_ctx_->GetLockManager()->LockTable(exec_ctx_->GetTransaction(),
-                                                         LockManager::LockMode::INTENTION_SHARED, plan_->GetTableOid());
-    if (!result) {
-      exec_ctx_->GetTransaction()->SetState(TransactionState::ABORTED);
-      throw std::exception();
-    }
-    // LOG_INFO("lock table IS");
-  }
-}
-
-auto SeqScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
-  auto lock_manager = exec_ctx_->GetLockManager();
-  auto transaction = exec_ctx_->GetTransaction();
-
-  if (iterator_ == exec_ctx_->GetCatalog()->GetTable(plan_->GetTableOid())->table_->End()) {
-    // read_commit下解锁
-    if (transaction->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
-      lock_manager->UnlockTable(transaction, plan_->GetTableOid());
-      // LOG_INFO("unlock table IS");
-    }
-    return false;
-  }
-
-  if (transaction->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
-    bool result =
-        lock_manager->LockRow(transaction, LockManager::LockMode::SHARED, plan_->GetTableOid(), iterator_->GetRid());
-    if (!result) {
-      exec_ctx_->GetTransaction()->SetState(TransactionState::ABORTED);
-      throw std::exception();
-    }
-    // LOG_INFO("lock row S");
-  }
-
-  *tuple = Tuple(*iterator_);
-  *rid = tuple->GetRid();
-  ++iterator_;
-
-  if (transaction->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
-    lock_manager->UnlockRow(transaction, plan_->GetTableOid(), *rid);
-    // LOG_INFO("unlock row S");
-  }
-
-  return true;
-}
-
-}  // namespace bustub
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// seq_scan_executor.cpp
+//
+// Identification: src/execution/seq_scan_executor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/executors/seq_scan_executor.h"
+
+#include "storage/page/table_page.h"
+
+namespace bustub {
+
+SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      table_info_(exec_ctx_->GetCatalog()->GetTable(plan_->GetTableOid())),
+      next_page_id_(table_info_->table_->GetFirstPageId()) {}
+
+void SeqScanExecutor::Init() {
+  next_page_id_ = table_info_->table_->GetFirstPageId();
+  page_buf_.clear();
+  page_pos_ = 0;
+
+  // 获取table锁。事务已持有S/X/IX/SIX中任何一个时IS都是多余的——要么
+  // 已覆盖读语义要么意向更强，再申请只是白走一趟锁管理器的表等待队列；
+  // 跳过时记下没拿，扫描结束的解锁也跟着跳过，不碰别的算子拿的锁
+  auto *transaction = exec_ctx_->GetTransaction();
+  auto oid = plan_->GetTableOid();
+  took_table_lock_ = false;
+  if (transaction->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
+    if (transaction->IsTableSharedLocked(oid) || transaction->IsTableExclusiveLocked(oid) ||
+        transaction->IsTableIntentionExclusiveLocked(oid) || transaction->IsTableSharedIntentionExclusiveLocked(oid)) {
+      return;
+    }
+    bool result = exec_ctx_->GetLockManager()->LockTable(transaction, LockManager::LockMode::INTENTION_SHARED, oid);
+    if (!result) {
+      transaction->SetState(TransactionState::ABORTED);
+      throw std::exception();
+    }
+    took_table_lock_ = true;
+  }
+}
+
+auto SeqScanExecutor::FillNextPage() -> bool {
+  auto bpm = exec_ctx_->GetBufferPoolManager();
+  auto lock_manager = exec_ctx_->GetLockManager();
+  auto transaction = exec_ctx_->GetTransaction();
+
+  while (next_page_id_ != INVALID_PAGE_ID) {
+    auto cur_page = static_cast<TablePage *>(bpm->FetchPage(next_page_id_));
+    BUSTUB_ENSURE(cur_page != nullptr, "BPM full");
+
+    // 第一趟：一次页闩锁收齐本页所有存活RID，原来迭代器每前进一行都要
+    // 重新闩一次页
+    std::vector<RID> rids;
+    cur_page->RLatch();
+    RID rid;
+    if (cur_page->GetFirstTupleRid(&rid)) {
+      rids.push_back(rid);
+      while (cur_page->GetNextTupleRid(rids.back(), &rid)) {
+        rids.push_back(rid);
+      }
+    }
+    cur_page->RUnlatch();
+
+    // 行锁整页连发：LockRows按锁表分片归并本页RID，每个分片latch只拿
+    // 一次而不是每行一次。不能持页闩锁等锁，所以放在两趟之间。
+    // 表级已有S/X/SIX时整页免锁；单行已被本事务锁住的也跳过，只解
+    // 这里真正拿到的锁，别动写路径或之前语句留下的
+    auto oid = plan_->GetTableOid();
+    bool need_row_locks = transaction->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+                          !transaction->IsTableSharedLocked(oid) && !transaction->IsTableExclusiveLocked(oid) &&
+                          !transaction->IsTableSharedIntentionExclusiveLocked(oid);
+    std::vector<RID> locked;
+    if (need_row_locks) {
+      locked.reserve(rids.size());
+      for (auto &r : rids) {
+        if (transaction->IsRowSharedLocked(oid, r) || transaction->IsRowExclusiveLocked(oid, r)) {
+          continue;
+        }
+        locked.push_back(r);
+      }
+      if (!lock_manager->LockRows(transaction, LockManager::LockMode::SHARED, oid, locked)) {
+        transaction->SetState(TransactionState::ABORTED);
+        bpm->UnpinPage(cur_page->GetTablePageId(), false);
+        throw std::exception();
+      }
+    }
+
+    // 第二趟：再闩一次整批拷出元组体。非RU下行锁已挡住写者；RU下拿锁
+    // 期间行可能被删，GetTuple返回false就跳过。
+    // 按槽号倒序拷：元组体从页尾向前生长，槽号升序读正好是地址降序，
+    // 硬件预取器只认升序步长；倒着走槽号就是顺着走地址，Next再从
+    // page_buf_尾部往回发，输出顺序不变
+    cur_page->RLatch();
+    page_buf_.clear();
+    page_buf_.reserve(rids.size());
+    for (auto it = rids.rbegin(); it != rids.rend(); ++it) {
+      Tuple copied_tuple;
+      if (cur_page->GetTuple(*it, &copied_tuple, transaction, lock_manager)) {
+        page_buf_.emplace_back(std::move(copied_tuple), *it);
+      }
+    }
+    next_page_id_ = cur_page->GetNextPageId();
+    cur_page->RUnlatch();
+    bpm->UnpinPage(cur_page->GetTablePageId(), false);
+
+    // read_commit下读完本页就放行锁，同样整页一趟解完
+    if (transaction->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+      for (auto &r : locked) {
+        lock_manager->UnlockRow(transaction, oid, r);
+      }
+    }
+
+    page_pos_ = 0;
+    if (!page_buf_.empty()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+auto SeqScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  auto transaction = exec_ctx_->GetTransaction();
+
+  if (page_pos_ == page_buf_.size() && !FillNextPage()) {
+    // read_commit下解锁；Init因已有更强表锁没拿IS时这里也没得解
+    if (took_table_lock_ && transaction->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+      exec_ctx_->GetLockManager()->UnlockTable(transaction, plan_->GetTableOid());
+      took_table_lock_ = false;
+    }
+    return false;
+  }
+
+  // page_buf_是倒序填的，从尾部往回取还原成槽号顺序
+  auto &entry = page_buf_[page_buf_.size() - 1 - page_pos_];
+  *tuple = entry.first;
+  *rid = entry.second;
+  ++page_pos_;
+
+  return true;
+}
+
+}  // namespace bustub
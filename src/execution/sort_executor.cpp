@@ -1,7 +1,123 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
 #include "execution/executors/sort_executor.h"
+#include "execution/sort_key_codec.h"
 
 namespace bustub {
 
+/** 分区时比较结果按块无分支地写进偏移缓冲再成批交换（Edelkamp/Weiß的
+ * BlockQuickSort），消除快排分区步里难预测的数据依赖分支。两种元素
+ * 形态：(uint64键,下标)对，以及键和下标打包成一个uint64的稠密形态；
+ * 都按SortKeyOf取键排序，等键段留给调用方处理 */
+static constexpr size_t kPartitionBlock = 128;
+static constexpr size_t kInsertionThreshold = 24;
+
+static inline auto SortKeyOf(uint64_t x) -> uint64_t { return x; }
+static inline auto SortKeyOf(const std::pair<uint64_t, uint32_t> &x) -> uint64_t { return x.first; }
+
+template <typename Elem>
+static void InsertionSortByKey(Elem *a, size_t lo, size_t hi) {
+  for (size_t i = lo + 1; i < hi; ++i) {
+    auto tmp = a[i];
+    size_t j = i;
+    while (j > lo && SortKeyOf(a[j - 1]) > SortKeyOf(tmp)) {
+      a[j] = a[j - 1];
+      --j;
+    }
+    a[j] = tmp;
+  }
+}
+
+template <typename Elem>
+static void BlockQuickSortByKey(Elem *a, size_t lo, size_t hi) {
+  while (hi - lo > kInsertionThreshold) {
+    // 三数取中做枢轴，挪到lo位当哨兵
+    size_t m = lo + (hi - lo) / 2;
+    if (SortKeyOf(a[m]) < SortKeyOf(a[lo])) {
+      std::swap(a[m], a[lo]);
+    }
+    if (SortKeyOf(a[hi - 1]) < SortKeyOf(a[lo])) {
+      std::swap(a[hi - 1], a[lo]);
+    }
+    if (SortKeyOf(a[hi - 1]) < SortKeyOf(a[m])) {
+      std::swap(a[hi - 1], a[m]);
+    }
+    std::swap(a[lo], a[m]);
+    uint64_t pivot = SortKeyOf(a[lo]);
+
+    size_t left = lo + 1;
+    size_t right = hi - 1;
+    uint8_t offsets_l[kPartitionBlock];
+    uint8_t offsets_r[kPartitionBlock];
+    size_t start_l = 0;
+    size_t num_l = 0;
+    size_t start_r = 0;
+    size_t num_r = 0;
+    while (right - left + 1 > 2 * kPartitionBlock) {
+      // 无条件写偏移、用比较结果当增量，块内循环一个分支都不带
+      if (num_l == 0) {
+        start_l = 0;
+        for (size_t i = 0; i < kPartitionBlock; ++i) {
+          offsets_l[num_l] = static_cast<uint8_t>(i);
+          num_l += static_cast<size_t>(SortKeyOf(a[left + i]) >= pivot);
+        }
+      }
+      if (num_r == 0) {
+        start_r = 0;
+        for (size_t i = 0; i < kPartitionBlock; ++i) {
+          offsets_r[num_r] = static_cast<uint8_t>(i);
+          num_r += static_cast<size_t>(SortKeyOf(a[right - i]) <= pivot);
+        }
+      }
+      size_t num = std::min(num_l, num_r);
+      for (size_t i = 0; i < num; ++i) {
+        std::swap(a[left + offsets_l[start_l + i]], a[right - offsets_r[start_r + i]]);
+      }
+      num_l -= num;
+      num_r -= num;
+      start_l += num;
+      start_r += num;
+      if (num_l == 0) {
+        left += kPartitionBlock;
+      }
+      if (num_r == 0) {
+        right -= kPartitionBlock;
+      }
+    }
+    // 清理：把残留的已标记元素压到所在块靠中间的一端，未标记前缀/后缀
+    // 并入已分好的两侧，剩下的中间小段一次线性分区收尾
+    if (num_l != 0) {
+      size_t tail = left + kPartitionBlock;
+      for (size_t j = num_l; j > 0; --j) {
+        std::swap(a[left + offsets_l[start_l + j - 1]], a[--tail]);
+      }
+      left = tail;
+    }
+    if (num_r != 0) {
+      size_t head = right - kPartitionBlock;
+      for (size_t j = num_r; j > 0; --j) {
+        std::swap(a[right - offsets_r[start_r + j - 1]], a[++head]);
+      }
+      right = head;
+    }
+    size_t mid = std::partition(a + left, a + right + 1, [pivot](const Elem &x) { return SortKeyOf(x) < pivot; }) - a;
+    std::swap(a[lo], a[mid - 1]);
+
+    // 先递归小的一侧，大的留在循环里，栈深保持O(logn)
+    if (mid - 1 - lo < hi - mid) {
+      BlockQuickSortByKey(a, lo, mid - 1);
+      lo = mid;
+    } else {
+      BlockQuickSortByKey(a, mid, hi);
+      hi = mid - 1;
+    }
+  }
+  InsertionSortByKey(a, lo, hi);
+}
+
 SortExecutor::SortExecutor(ExecutorContext *exec_ctx, const SortPlanNode *plan,
                            std::unique_ptr<AbstractExecutor> &&child_executor)
     : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
@@ -9,29 +125,195 @@ SortExecutor::SortExecutor(ExecutorContext *exec_ctx, const SortPlanNode *plan,
 void SortExecutor::Init() {
   child_executor_->Init();
   index_ = 0;
+  tuples_.clear();
 
   Tuple child_tuple{};
   RID rid;
   auto status = child_executor_->Next(&child_tuple, &rid);
 
   while (status) {
-    tuples_.push_back(child_tuple);
+    tuples_.push_back(std::move(child_tuple));
     status = child_executor_->Next(&child_tuple, &rid);
   }
 
   auto orderbytypes = plan_->GetOrderBy();
-  std::sort(tuples_.begin(), tuples_.end(), [&](Tuple &a, Tuple &b) {
-    for (auto &orderbytype : orderbytypes) {
-      Value key1 = orderbytype.second->Evaluate(&a, GetOutputSchema());
-      Value key2 = orderbytype.second->Evaluate(&b, GetOutputSchema());
+
+  // 只把首个排序键预先求值成与tuples_平行的数组：绝大多数比较在首键就
+  // 分出胜负，次级键等到首键相等时再对两个元组按需Evaluate，省下K倍的
+  // Value缓存和快路径上的全部次级求值
+  std::vector<Value> leading;
+  leading.reserve(tuples_.size());
+  for (auto &tuple : tuples_) {
+    leading.push_back(orderbytypes[0].second->Evaluate(&tuple, GetOutputSchema()));
+  }
+
+  // 首键相等后的次级键比较，两条排序路径共用
+  auto tail_before = [&](uint32_t a, uint32_t b) {
+    for (size_t i = 1; i < orderbytypes.size(); ++i) {
+      Value key1 = orderbytypes[i].second->Evaluate(&tuples_[a], GetOutputSchema());
+      Value key2 = orderbytypes[i].second->Evaluate(&tuples_[b], GetOutputSchema());
       if (key1.CompareEquals(key2) == CmpBool::CmpTrue) {
         continue;
       }
-      return orderbytype.first == OrderByType::DESC ? key1.CompareLessThan(key2) == CmpBool::CmpFalse
-                                                    : key1.CompareLessThan(key2) == CmpBool::CmpTrue;
+      return orderbytypes[i].first == OrderByType::DESC ? key1.CompareLessThan(key2) == CmpBool::CmpFalse
+                                                        : key1.CompareLessThan(key2) == CmpBool::CmpTrue;
+    }
+
+    // 全部键相等时必须返回false，std::sort要求严格弱序
+    return false;
+  };
+
+  // 定宽首键改用保序的uint64替代键：CompareLessThan每次都要经过类型
+  // 分发的虚调用，替代键把热循环变成紧凑数组上的纯整数比较。编码对
+  // 这些类型是单射，替代键相等即Value相等，直接落到次级键。
+  // 窄类型（≤32位）首键进一步把键和下标打包成一个uint64：(键<<32)|下标，
+  // 排序流从16字节的(键,下标)对收窄成8字节稠密数组，一次比较一次搬运
+  // 都只碰一个字；键相等时低位下标自然升序，不影响等键段语义
+  std::vector<std::pair<uint64_t, uint32_t>> skeys;
+  std::vector<uint64_t> packed;
+  bool use_surrogate = SurrogateSortable(orderbytypes[0].second->GetReturnType());
+  bool use_packed = use_surrogate && Surrogate32Sortable(orderbytypes[0].second->GetReturnType());
+  if (use_surrogate) {
+    if (use_packed) {
+      packed.reserve(tuples_.size());
+    } else {
+      skeys.reserve(tuples_.size());
+    }
+    for (size_t i = 0; i < leading.size(); ++i) {
+      // NULL的排序位置由Value比较语义决定，出现即放弃替代键路径
+      if (leading[i].IsNull()) {
+        use_surrogate = false;
+        break;
+      }
+      if (use_packed) {
+        uint32_t key = SurrogateKey32(leading[i]);
+        if (orderbytypes[0].first == OrderByType::DESC) {
+          key = ~key;
+        }
+        packed.push_back((static_cast<uint64_t>(key) << 32) | i);
+      } else {
+        uint64_t key = SurrogateKey(leading[i]);
+        if (orderbytypes[0].first == OrderByType::DESC) {
+          key = ~key;
+        }
+        skeys.emplace_back(key, static_cast<uint32_t>(i));
+      }
     }
+  }
 
-    return true;
+  // 次级键也全部定宽时，等键段的比较器同样特化成纯整数比较：段内每个
+  // 元组把K-1个次级键一次性Evaluate成保序uint64行，排序热循环就只剩
+  // 对齐load加原生比较，彻底绕开Evaluate虚调用和Value的类型分发。
+  // 求值量从每次比较K个降到每元素K个，段外元组一个次级键都不求
+  bool tails_surrogate = true;
+  for (size_t i = 1; i < orderbytypes.size(); ++i) {
+    tails_surrogate = tails_surrogate && SurrogateSortable(orderbytypes[i].second->GetReturnType());
+  }
+  // 两种键布局共用：通过idx_of/set_idx读写段内元组下标，段本体不关心
+  // 键存成对还是打包字
+  auto sort_equal_run = [&](size_t run_begin, size_t run_end, auto idx_of, auto set_idx) {
+    size_t k2 = orderbytypes.size() - 1;
+    size_t len = run_end - run_begin;
+    std::vector<uint32_t> idx(len);
+    for (size_t j = 0; j < len; ++j) {
+      idx[j] = idx_of(run_begin + j);
+    }
+    if (tails_surrogate) {
+      std::vector<uint64_t> run_keys(len * k2);
+      bool ok = true;
+      for (size_t j = 0; j < len && ok; ++j) {
+        for (size_t i = 1; i <= k2; ++i) {
+          Value v = orderbytypes[i].second->Evaluate(&tuples_[idx[j]], GetOutputSchema());
+          if (v.IsNull()) {
+            ok = false;
+            break;
+          }
+          uint64_t key = SurrogateKey(v);
+          if (orderbytypes[i].first == OrderByType::DESC) {
+            key = ~key;
+          }
+          run_keys[j * k2 + (i - 1)] = key;
+        }
+      }
+      if (ok) {
+        // run_keys按段内原始位置存行，排位置置换再写回，行本体不搬
+        std::vector<uint32_t> perm(len);
+        std::iota(perm.begin(), perm.end(), 0);
+        std::sort(perm.begin(), perm.end(), [&](uint32_t x, uint32_t y) {
+          const uint64_t *ka = &run_keys[static_cast<size_t>(x) * k2];
+          const uint64_t *kb = &run_keys[static_cast<size_t>(y) * k2];
+          for (size_t i = 0; i < k2; ++i) {
+            if (ka[i] != kb[i]) {
+              return ka[i] < kb[i];
+            }
+          }
+          return false;
+        });
+        for (size_t j = 0; j < len; ++j) {
+          set_idx(run_begin + j, idx[perm[j]]);
+        }
+        return;
+      }
+    }
+    // NULL或变宽键：回退到按需Evaluate的通用比较
+    std::sort(idx.begin(), idx.end(), tail_before);
+    for (size_t j = 0; j < len; ++j) {
+      set_idx(run_begin + j, idx[j]);
+    }
+  };
+
+  order_.resize(tuples_.size());
+  if (use_surrogate && use_packed) {
+    BlockQuickSortByKey(packed.data(), 0, packed.size());
+    // 等键段看高32位；段内按次级键重排只改写低32位的下标
+    if (orderbytypes.size() > 1) {
+      auto idx_of = [&](size_t j) { return static_cast<uint32_t>(packed[j]); };
+      auto set_idx = [&](size_t j, uint32_t v) { packed[j] = (packed[j] >> 32 << 32) | v; };
+      size_t run_begin = 0;
+      for (size_t i = 1; i <= packed.size(); ++i) {
+        if (i == packed.size() || (packed[i] >> 32) != (packed[run_begin] >> 32)) {
+          if (i - run_begin > 1) {
+            sort_equal_run(run_begin, i, idx_of, set_idx);
+          }
+          run_begin = i;
+        }
+      }
+    }
+    for (size_t i = 0; i < packed.size(); ++i) {
+      order_[i] = static_cast<uint32_t>(packed[i]);
+    }
+    return;
+  }
+  if (use_surrogate) {
+    BlockQuickSortByKey(skeys.data(), 0, skeys.size());
+    // 等键段内再按次级键排；只有首键时等键段次序任意，直接跳过
+    if (orderbytypes.size() > 1) {
+      auto idx_of = [&](size_t j) { return skeys[j].second; };
+      auto set_idx = [&](size_t j, uint32_t v) { skeys[j].second = v; };
+      size_t run_begin = 0;
+      for (size_t i = 1; i <= skeys.size(); ++i) {
+        if (i == skeys.size() || skeys[i].first != skeys[run_begin].first) {
+          if (i - run_begin > 1) {
+            sort_equal_run(run_begin, i, idx_of, set_idx);
+          }
+          run_begin = i;
+        }
+      }
+    }
+    for (size_t i = 0; i < skeys.size(); ++i) {
+      order_[i] = skeys[i].second;
+    }
+    return;
+  }
+
+  // 排下标置换而不是Tuple本体：swap只搬4字节，元组存储不动
+  std::iota(order_.begin(), order_.end(), 0);
+  std::sort(order_.begin(), order_.end(), [&](uint32_t a, uint32_t b) {
+    if (leading[a].CompareEquals(leading[b]) != CmpBool::CmpTrue) {
+      return orderbytypes[0].first == OrderByType::DESC ? leading[a].CompareLessThan(leading[b]) == CmpBool::CmpFalse
+                                                        : leading[a].CompareLessThan(leading[b]) == CmpBool::CmpTrue;
+    }
+    return tail_before(a, b);
   });
 }
 
@@ -40,7 +322,7 @@ auto SortExecutor::Next(Tuple *tuple, RID *rid) -> bool {
     return false;
   }
 
-  *tuple = tuples_[index_];
+  *tuple = tuples_[order_[index_]];
   ++index_;
   return true;
 }
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <utility>
+
 #include "execution/executors/topn_executor.h"
+#include "execution/sort_key_codec.h"
 
 namespace bustub {
 
@@ -9,34 +13,96 @@ TopNExecutor::TopNExecutor(ExecutorContext *exec_ctx, const TopNPlanNode *plan,
 void TopNExecutor::Init() {
   child_executor_->Init();
   index_ = 0;
+  result_.clear();
   auto orderbytypes = plan_->GetOrderBy();
-  auto cmp = [&](Tuple &a, Tuple &b) {
-    for (auto &orderbytype : orderbytypes) {
-      Value key1 = orderbytype.second->Evaluate(&a, GetOutputSchema());
-      Value key2 = orderbytype.second->Evaluate(&b, GetOutputSchema());
+
+  // 堆元素只随身缓存首键：绝大多数比较在首键就分出胜负，次级键等到
+  // 首键相等时再对两个元组按需Evaluate，堆元素保持定长。定宽首键额外
+  // 带一份保序uint64替代键（与SortExecutor同一套编码），堆比较的快
+  // 路径是一次原生整数比较，不经过Value的类型分发；NULL没有替代键，
+  // 两边都有效才走快路径
+  struct Entry {
+    uint64_t skey_;
+    bool skey_valid_;
+    Value leading_;
+    Tuple tuple_;
+  };
+
+  bool leading_surrogate = SurrogateSortable(orderbytypes[0].second->GetReturnType());
+  auto encode = [&](const Value &leading) -> std::pair<uint64_t, bool> {
+    if (!leading_surrogate || leading.IsNull()) {
+      return {0, false};
+    }
+    uint64_t key = SurrogateKey(leading);
+    if (orderbytypes[0].first == OrderByType::DESC) {
+      key = ~key;
+    }
+    return {key, true};
+  };
+
+  auto keys_before = [&](const Entry &a, const Entry &b) {
+    if (a.skey_valid_ && b.skey_valid_) {
+      if (a.skey_ != b.skey_) {
+        return a.skey_ < b.skey_;
+      }
+    } else if (a.leading_.CompareEquals(b.leading_) != CmpBool::CmpTrue) {
+      return orderbytypes[0].first == OrderByType::DESC
+                 ? a.leading_.CompareLessThan(b.leading_) == CmpBool::CmpFalse
+                 : a.leading_.CompareLessThan(b.leading_) == CmpBool::CmpTrue;
+    }
+    const Tuple &tuple_a = a.tuple_;
+    const Tuple &tuple_b = b.tuple_;
+    for (size_t i = 1; i < orderbytypes.size(); ++i) {
+      Value key1 = orderbytypes[i].second->Evaluate(&tuple_a, GetOutputSchema());
+      Value key2 = orderbytypes[i].second->Evaluate(&tuple_b, GetOutputSchema());
       if (key1.CompareEquals(key2) == CmpBool::CmpTrue) {
         continue;
       }
-      return orderbytype.first == OrderByType::DESC ? key1.CompareLessThan(key2) == CmpBool::CmpTrue
-                                                    : key1.CompareLessThan(key2) == CmpBool::CmpFalse;
+      return orderbytypes[i].first == OrderByType::DESC ? key1.CompareLessThan(key2) == CmpBool::CmpFalse
+                                                        : key1.CompareLessThan(key2) == CmpBool::CmpTrue;
     }
 
-    return true;
+    return false;
   };
+  // “输出序靠前”作为less：堆顶是当前Top-N里最差的一个，新元组只要不比它好
+  // 就直接丢弃，堆的大小始终不超过N
+  auto before = [&](const Entry &a, const Entry &b) { return keys_before(a, b); };
 
-  std::priority_queue<Tuple, std::vector<Tuple>, decltype(cmp)> que(cmp);
+  // 手动管理的vector堆：前N个元组先整批make_heap（O(N)），省掉逐个push
+  // 的O(N·logN)上浮；替换堆顶时back()原地赋值，不经过pop/push的搬运
+  std::vector<Entry> heap;
+  size_t n = plan_->GetN();
+  heap.reserve(n);
 
   Tuple child_tuple{};
   RID rid;
   auto status = child_executor_->Next(&child_tuple, &rid);
+  while (status && heap.size() < n) {
+    // 先求键再搬元组，不能在聚合初始化列表里对child_tuple又求值又move
+    Value leading = orderbytypes[0].second->Evaluate(&child_tuple, GetOutputSchema());
+    auto [skey, skey_valid] = encode(leading);
+    heap.push_back(Entry{skey, skey_valid, std::move(leading), std::move(child_tuple)});
+    status = child_executor_->Next(&child_tuple, &rid);
+  }
+  std::make_heap(heap.begin(), heap.end(), before);
+
   while (status) {
-    que.push(child_tuple);
+    Value leading = orderbytypes[0].second->Evaluate(&child_tuple, GetOutputSchema());
+    auto [skey, skey_valid] = encode(leading);
+    Entry incoming{skey, skey_valid, std::move(leading), std::move(child_tuple)};
+    if (n > 0 && keys_before(incoming, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), before);
+      heap.back() = std::move(incoming);
+      std::push_heap(heap.begin(), heap.end(), before);
+    }
     status = child_executor_->Next(&child_tuple, &rid);
   }
-  int emit_size = plan_->GetN();
-  while ((emit_size--) != 0 && !que.empty()) {
-    result_.push_back(que.top());
-    que.pop();
+
+  // sort_heap按比较器升序排列，正好就是输出序
+  std::sort_heap(heap.begin(), heap.end(), before);
+  result_.reserve(heap.size());
+  for (auto &entry : heap) {
+    result_.push_back(std::move(entry.tuple_));
   }
 }
 
@@ -15,6 +15,7 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -84,6 +85,20 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Delete a batch of pages in one call, so callers that free several pages
+   * per operation pay for the pool's latching once instead of per page.
+   */
+  void DeletePages(const std::vector<page_id_t> &page_ids) { DeletePgsImp(page_ids); }
+
+  /**
+   * Cache-warming hint: if page_id is resident, prefetch its frame's data
+   * into the CPU cache; otherwise do nothing. Takes no pin and issues no
+   * disk I/O, so the page may still be evicted before the follow-up
+   * FetchPage — this is purely best-effort.
+   */
+  virtual void PrefetchPage(page_id_t page_id) {}
+
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
@@ -137,6 +152,16 @@ class BufferPoolManager {
    */
   virtual auto DeletePgImp(page_id_t page_id) -> bool = 0;
 
+  /**
+   * Deletes a batch of pages from the buffer pool. Default loops DeletePgImp;
+   * implementations can override to amortise their latching over the batch.
+   */
+  virtual void DeletePgsImp(const std::vector<page_id_t> &page_ids) {
+    for (page_id_t page_id : page_ids) {
+      DeletePgImp(page_id);
+    }
+  }
+
   /**
    * Flushes all the pages in the buffer pool to disk.
    */
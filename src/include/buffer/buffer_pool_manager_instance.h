@@ -12,14 +12,17 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
 #include <list>
-#include <mutex>  // NOLINT
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/lru_k_replacer.h"
 #include "common/config.h"
-#include "container/hash/extendible_hash_table.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -49,6 +52,9 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @brief Return the size (number of frames) of the buffer pool. */
   auto GetPoolSize() -> size_t override { return pool_size_; }
 
+  /** @brief Prefetch a resident page's data into the CPU cache without pinning it. */
+  void PrefetchPage(page_id_t page_id) override;
+
   /** @brief Return the pointer to all the pages in the buffer pool. */
   auto GetPages() -> Page * { return pages_; }
 
@@ -140,12 +146,13 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   auto DeletePgImp(page_id_t page_id) -> bool override;
 
+  /** Batched delete: one exclusive acquisition of the frame latch for the whole batch. */
+  void DeletePgsImp(const std::vector<page_id_t> &page_ids) override;
+
   /** Number of pages in the buffer pool. */
   const size_t pool_size_;
   /** The next page id to be allocated  */
   std::atomic<page_id_t> next_page_id_ = 0;
-  /** Bucket size for the extendible hash table */
-  const size_t bucket_size_ = 4;
 
   /** Array of buffer pool pages. */
   Page *pages_;
@@ -153,14 +160,200 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. Please ignore this for P1. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  ExtendibleHashTable<page_id_t, frame_id_t> *page_table_;
+  /** Number of page-table stripes; must be a power of two. */
+  static constexpr size_t NUM_SHARDS = 16;
+
+  /**
+   * Open-addressing page table stripe: flat arrays with linear probing and
+   * backward-shift deletion. The buffer pool holds at most pool_size live
+   * mappings, so each stripe is sized once (2x pool_size, power of two) and
+   * never rehashes; a probe is a couple of contiguous array reads instead of
+   * a bucket-chain pointer chase.
+   */
+  struct FlatPageTable {
+    static constexpr page_id_t EMPTY_KEY = INVALID_PAGE_ID;
+
+    std::vector<page_id_t> keys_;
+    std::vector<frame_id_t> vals_;
+    size_t mask_{0};
+
+    void Init(size_t pool_size) {
+      size_t capacity = 8;
+      while (capacity < pool_size * 2) {
+        capacity <<= 1;
+      }
+      keys_.assign(capacity, EMPTY_KEY);
+      vals_.resize(capacity);
+      mask_ = capacity - 1;
+    }
+
+    /** home slot; page ids within a stripe share their low shard bits, so probe by the high bits */
+    auto IndexOf(page_id_t key) const -> size_t { return (static_cast<size_t>(key) / NUM_SHARDS) & mask_; }
+
+    auto Find(page_id_t key, frame_id_t *val) const -> bool {
+      for (size_t i = IndexOf(key); keys_[i] != EMPTY_KEY; i = (i + 1) & mask_) {
+        if (keys_[i] == key) {
+          *val = vals_[i];
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void Insert(page_id_t key, frame_id_t val) {
+      size_t i = IndexOf(key);
+      while (keys_[i] != EMPTY_KEY && keys_[i] != key) {
+        i = (i + 1) & mask_;
+      }
+      keys_[i] = key;
+      vals_[i] = val;
+    }
+
+    void Erase(page_id_t key) {
+      if (key == EMPTY_KEY) {
+        return;
+      }
+      size_t i = IndexOf(key);
+      while (keys_[i] != key) {
+        if (keys_[i] == EMPTY_KEY) {
+          return;
+        }
+        i = (i + 1) & mask_;
+      }
+      // backward-shift deletion keeps probe chains intact without tombstones
+      size_t j = i;
+      while (true) {
+        keys_[i] = EMPTY_KEY;
+        while (true) {
+          j = (j + 1) & mask_;
+          if (keys_[j] == EMPTY_KEY) {
+            return;
+          }
+          size_t home = IndexOf(keys_[j]);
+          bool movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+          if (movable) {
+            break;
+          }
+        }
+        keys_[i] = keys_[j];
+        vals_[i] = vals_[j];
+        i = j;
+      }
+    }
+  };
+
+  /** One stripe of the page table with its own latch, so lookups on
+   * different pages do not serialise on a single map lock. */
+  struct PageTableShard {
+    std::mutex latch_;
+    FlatPageTable table_;
+  };
+
+  /** Page table for keeping track of buffer pool pages, striped by page id. */
+  PageTableShard shards_[NUM_SHARDS];
   /** Replacer to find unpinned pages for replacement. */
   LRUKReplacer *replacer_;
-  /** List of free frames that don't have any pages on them. */
-  std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+  /**
+   * Lock-free free list: a Treiber stack threaded through per-frame next
+   * slots. The head packs a 32-bit ABA tag with the top frame index, so push
+   * and pop are single CAS loops with no latch.
+   */
+  static constexpr uint32_t FREE_LIST_NIL = UINT32_MAX;
+  std::vector<uint32_t> free_next_;
+  std::atomic<uint64_t> free_head_{static_cast<uint64_t>(FREE_LIST_NIL)};
+  /** Protects the frame state machine: victim selection, page <-> frame rebinding and pin transitions.
+   * Fetch hits only need it shared — they never rebind a frame — so they can run concurrently;
+   * paths that claim or rebind frames take it exclusively. */
+  std::shared_mutex latch_;
+
+  /** Pages with disk I/O in flight (victim write-out or faulting read). A
+   * fetch of such a page waits on io_cv_ instead of issuing duplicate I/O. */
+  std::unordered_set<page_id_t> io_pages_;
+  std::mutex io_latch_;
+  std::condition_variable io_cv_;
+
+  /** Mark page_id as having I/O in flight. */
+  void BeginIo(page_id_t page_id) {
+    std::scoped_lock<std::mutex> lock(io_latch_);
+    io_pages_.insert(page_id);
+  }
+
+  /** Clear the in-flight mark for page_id and wake any waiting fetchers. */
+  void EndIo(page_id_t page_id) {
+    {
+      std::scoped_lock<std::mutex> lock(io_latch_);
+      io_pages_.erase(page_id);
+    }
+    io_cv_.notify_all();
+  }
+
+  /** @return true if page_id currently has I/O in flight. Caller holds io_latch_. */
+  auto IoInFlight(page_id_t page_id) -> bool { return io_pages_.find(page_id) != io_pages_.end(); }
+
+  /** @return the page-table shard that owns page_id */
+  auto ShardFor(page_id_t page_id) -> PageTableShard & {
+    return shards_[static_cast<size_t>(page_id) & (NUM_SHARDS - 1)];
+  }
+
+  /** Look up page_id in its shard. @return true and set frame_id on hit. */
+  auto FindFrame(page_id_t page_id, frame_id_t *frame_id) -> bool {
+    auto &shard = ShardFor(page_id);
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    return shard.table_.Find(page_id, frame_id);
+  }
+
+  /** Bind page_id to frame_id in its shard. */
+  void InsertFrame(page_id_t page_id, frame_id_t frame_id) {
+    auto &shard = ShardFor(page_id);
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    shard.table_.Insert(page_id, frame_id);
+  }
+
+  /** Drop page_id's binding from its shard, if any. */
+  void EraseFrame(page_id_t page_id) {
+    auto &shard = ShardFor(page_id);
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    shard.table_.Erase(page_id);
+  }
+
+  /**
+   * Claim a victim frame from the replacer. Re-checks the pin count after the
+   * replacer hands a frame out, since unpinning marks frames evictable outside
+   * the global latch. Caller holds latch_.
+   * @return true and set frame_id if an unpinned victim was claimed
+   */
+  auto AcquireVictim(frame_id_t *frame_id) -> bool;
+
+  /** Pop a frame from the free list. @return true on success. */
+  auto PopFreeFrame(frame_id_t *frame_id) -> bool {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    while (true) {
+      auto top = static_cast<uint32_t>(head);
+      if (top == FREE_LIST_NIL) {
+        return false;
+      }
+      uint64_t tag = (head >> 32U) + 1;
+      uint64_t next = (tag << 32U) | free_next_[top];
+      if (free_head_.compare_exchange_weak(head, next, std::memory_order_acq_rel)) {
+        *frame_id = static_cast<frame_id_t>(top);
+        return true;
+      }
+    }
+  }
+
+  /** Push a frame onto the free list. */
+  void PushFreeFrame(frame_id_t frame_id) {
+    auto idx = static_cast<uint32_t>(frame_id);
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    while (true) {
+      free_next_[idx] = static_cast<uint32_t>(head);
+      uint64_t tag = (head >> 32U) + 1;
+      uint64_t next = (tag << 32U) | idx;
+      if (free_head_.compare_exchange_weak(head, next, std::memory_order_acq_rel)) {
+        return;
+      }
+    }
+  }
 
   /**
    * @brief Allocate a page on disk. Caller should acquire the latch before calling this function.
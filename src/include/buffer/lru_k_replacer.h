@@ -16,9 +16,12 @@
 #include <climits>
 #include <deque>
 #include <list>
+#include <memory_resource>
 #include <mutex>  // NOLINT
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "common/config.h"
@@ -90,6 +93,16 @@ class LRUKReplacer {
    */
   void RecordAccess(frame_id_t frame_id);
 
+  /**
+   * @brief Record an access and mark the frame non-evictable in a single
+   * latch acquisition. Equivalent to RecordAccess(frame_id) followed by
+   * SetEvictable(frame_id, false), which every buffer pool entry point calls
+   * back-to-back when pinning a frame.
+   *
+   * @param frame_id id of frame being pinned
+   */
+  void Pin(frame_id_t frame_id);
+
   /**
    * TODO(P1): Add implementation
    *
@@ -137,14 +150,57 @@ class LRUKReplacer {
    */
   auto Size() -> size_t;
 
+  /** Per-frame metadata, stored densely and indexed by frame_id. The access
+   * history itself lives in hist_pool_, a k-slot ring per frame. */
   struct FrameInfo {
-    FrameInfo(frame_id_t frame_id, int current_timestamp) : frame_id_(frame_id) { hast_.push_back(current_timestamp); }
-    frame_id_t frame_id_;
-    std::list<int> hast_;
+    frame_id_t frame_id_{-1};
+    /** ring slot of the most recent access */
+    uint8_t head_{0};
+    /** number of recorded accesses, capped at k */
+    uint8_t len_{0};
     bool is_evictable_{false};
+    /** whether this frame currently has an access history in the replacer */
+    bool in_replacer_{false};
   };
 
  private:
+  /** @return the oldest retained access timestamp of a frame: the first access
+   * while it has fewer than k references, the k-th most recent one afterwards. */
+  auto BackTs(const FrameInfo &info) const -> size_t {
+    size_t slot = info.head_ + info.len_ - 1;
+    if (slot >= k_) {
+      slot -= k_;
+    }
+    return hist_pool_[static_cast<size_t>(info.frame_id_) * k_ + slot];
+  }
+
+  /** Record a new access timestamp in the frame's ring. O(1), no allocation,
+   * and the wrap-around is a compare instead of an integer modulo. */
+  void PushTs(FrameInfo &info, size_t ts) {
+    info.head_ = static_cast<uint8_t>(info.head_ == 0 ? k_ - 1 : info.head_ - 1);
+    hist_pool_[static_cast<size_t>(info.frame_id_) * k_ + info.head_] = ts;
+    if (info.len_ < k_) {
+      ++info.len_;
+    }
+  }
+
+  /**
+   * Ordering key of a frame inside the victim index; the smallest key is
+   * always the eviction victim.
+   */
+  auto KeyOf(const FrameInfo &info) const -> std::pair<size_t, frame_id_t> {
+    return {BackTs(info), info.frame_id_};
+  }
+
+  /** Insert an evictable frame into the victim index. */
+  void IndexInsert(const FrameInfo &info);
+
+  /** Erase an evictable frame from the victim index. */
+  void IndexErase(const FrameInfo &info);
+
+  /** Pick and erase the victim from the index. Caller holds latch_. */
+  auto EvictInternal(frame_id_t *frame_id) -> bool;
+
   // TODO(student): implement me! You can replace these member variables as you like.
   // Remove maybe_unused if you start using them.
   size_t current_timestamp_{0};
@@ -152,8 +208,21 @@ class LRUKReplacer {
   size_t replacer_size_;
   size_t k_;
 
-  std::list<FrameInfo> list_;
-  std::unordered_map<frame_id_t, std::list<FrameInfo>::iterator> cache_;
+  /** dense per-frame metadata indexed by frame_id; no hash probe on the hot path */
+  std::vector<FrameInfo> frames_;
+  /** k timestamp slots per frame, allocated once; frame i owns [i * k_, (i + 1) * k_) */
+  std::vector<size_t> hist_pool_;
+  /** number of frames currently tracked by the replacer */
+  size_t frame_cnt_{0};
+
+  /** node pool for the victim sets: RecordAccess erases and reinserts a key on
+   * every access, so recycle tree nodes instead of hitting the heap each time.
+   * Guarded by latch_ like the sets themselves. */
+  std::pmr::unsynchronized_pool_resource set_pool_;
+  /** evictable frames with fewer than k accesses, ordered by first access (FIFO victim at begin()) */
+  std::pmr::set<std::pair<size_t, frame_id_t>> inf_set_{&set_pool_};
+  /** evictable frames with k accesses, ordered by k-th backward timestamp (max k-distance at begin()) */
+  std::pmr::set<std::pair<size_t, frame_id_t>> kth_set_{&set_pool_};
 
   std::mutex latch_;
 };
@@ -13,10 +13,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <list>
 #include <memory>
+#include <memory_resource>
 #include <mutex>  // NOLINT
+#include <shared_mutex>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -59,24 +63,89 @@ class LockManager {
     RID rid_;
     /** Whether the lock has been granted or not */
     bool granted_{false};
+    /** The owning transaction blocks here while the request is ungranted, so
+     * a grant or an abort wakes exactly this waiter instead of broadcasting
+     * to the whole queue. Waits use the queue latch. */
+    std::condition_variable cv_;
   };
 
-  class LockRequestQueue {
+  // Queues for unrelated tables/rows are allocated close together; aligning
+  // each queue to its own cache line keeps one queue's latch traffic from
+  // bouncing the line that holds a neighbour's latch.
+  class alignas(64) LockRequestQueue {
    public:
-    /** List of lock requests for the same resource (table or row) */
-    std::list<std::shared_ptr<LockRequest>> request_queue_;
-    /** For notifying blocked transactions on this rid */
-    std::condition_variable cv_;
-    /** txn_id of an upgrading transaction (if any) */
-    txn_id_t upgrading_ = INVALID_TXN_ID;
+    /** Node pool for the request list: lock/unlock on a hot resource churns
+     * one list node per request, so recycle nodes instead of hitting the
+     * heap each time (same pattern as the LRU-K victim sets). Guarded by
+     * latch_ like the list itself; must be declared before the list so it
+     * outlives it. */
+    std::pmr::unsynchronized_pool_resource node_pool_;
+
+    using RequestList = std::pmr::list<LockRequest>;
+
+    /** List of lock requests for the same resource (table or row). Requests
+     * are held by value: the queue is the sole owner, so each enqueue costs
+     * one pooled list-node allocation instead of a node plus a shared_ptr
+     * control block, and iteration touches no refcounts. List nodes never
+     * move, so raw pointers/iterators into the queue stay valid until erase. */
+    RequestList request_queue_{&node_pool_};
+    /** txn_id of an upgrading transaction (if any). Atomic so the grant path
+     * can bail with one relaxed load; writes still happen under latch_. */
+    std::atomic<txn_id_t> upgrading_ = INVALID_TXN_ID;
     /** coordination */
     std::mutex latch_;
+
+    /** Per-mode count of granted requests plus the bit set of held modes,
+     * kept in sync on every grant/release so compatibility against all
+     * holders is one AND instead of a queue walk. Guarded by latch_. */
+    std::array<uint16_t, 5> granted_counts_{};
+    uint8_t granted_modes_bits_{0};
+
+    /** Account for a request whose granted_ flag is being set. */
+    void OnGrant(LockMode mode) {
+      ++granted_counts_[static_cast<size_t>(mode)];
+      granted_modes_bits_ |= static_cast<uint8_t>(1U << static_cast<size_t>(mode));
+    }
+
+    /** Account for a granted request leaving the queue. */
+    void OnRelease(LockMode mode) {
+      if (--granted_counts_[static_cast<size_t>(mode)] == 0) {
+        granted_modes_bits_ &= static_cast<uint8_t>(~(1U << static_cast<size_t>(mode)));
+      }
+    }
+
+    /** txn_id -> position in request_queue_, so a transaction finds its own
+     * request in O(1) instead of scanning the queue. A transaction has at
+     * most one request per queue. Guarded by latch_. */
+    std::unordered_map<txn_id_t, RequestList::iterator> by_txn_;
+
+    /** Append a request and index it by transaction. */
+    template <typename... Args>
+    auto Enqueue(Args &&...args) -> RequestList::iterator {
+      auto iter = request_queue_.emplace(request_queue_.end(), std::forward<Args>(args)...);
+      by_txn_[iter->txn_id_] = iter;
+      return iter;
+    }
+
+    /** Remove a request and drop its index entry. */
+    void Dequeue(RequestList::iterator iter) {
+      by_txn_.erase(iter->txn_id_);
+      request_queue_.erase(iter);
+    }
+
+    /** @return iterator to the transaction's request, or request_queue_.end() */
+    auto FindRequest(txn_id_t txn_id) -> RequestList::iterator {
+      auto it = by_txn_.find(txn_id);
+      return it == by_txn_.end() ? request_queue_.end() : it->second;
+    }
   };
 
   /**
    * Creates a new lock manager configured for the deadlock detection policy.
    */
   LockManager() {
+    // clear()不回收桶数组，这里预留一次即可覆盖后续每轮检测
+    waits_for_.reserve(64);
     enable_cycle_detection_ = true;
     cycle_detection_thread_ = new std::thread(&LockManager::RunCycleDetection, this);
   }
@@ -219,10 +288,35 @@ class LockManager {
    */
   auto LockTable(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) noexcept(false) -> bool;
 
-  auto GrantTableLock(std::shared_ptr<LockRequestQueue> &lock_request_queue, std::shared_ptr<LockRequest> &lock_request)
-      -> bool;
+  /**
+   * Try to grant one request in its queue. Table and row paths share the
+   * logic; the only difference is that a row request matches itself by
+   * (txn_id, oid) instead of txn_id alone, selected at compile time so the
+   * table path carries no extra compare. Caller holds the queue latch.
+   * Defined in lock_manager.cpp, its only user.
+   */
+  template <bool WithRid>
+  auto GrantLock(std::shared_ptr<LockRequestQueue> &lock_request_queue, LockRequest *lock_request) -> bool;
 
   auto CheckCompatibility(LockMode hold_mode, LockMode want_mode) -> bool;
+
+  /**
+   * Row-lock admission checks shared by LockRow and LockRows: transaction
+   * state, mode legality, required table intention lock and 2PL policy.
+   * @return false if the transaction is already finished, true if admitted
+   */
+  auto ValidateRowLock(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool;
+
+  /** Find or create the request queue for a row in its lock-map shard. */
+  auto ResolveRowQueue(const RID &rid) -> std::shared_ptr<LockRequestQueue>;
+
+  /**
+   * Queue-level half of LockRow: upgrade handling, enqueue, wait for grant
+   * and bookkeeping, once the queue has been resolved.
+   */
+  auto LockRowOnQueue(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const RID &rid,
+                      std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool;
+
   /**
    * Release the lock held on a table by the transaction.
    *
@@ -236,8 +330,14 @@ class LockManager {
    */
   auto UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool;
 
-  auto GrantRowLock(std::shared_ptr<LockRequestQueue> &lock_request_queue, std::shared_ptr<LockRequest> &lock_request)
-      -> bool;
+
+  /**
+   * Grant every request that becomes grantable after a release, in FIFO order
+   * (a pending upgrade keeps its priority). Caller holds the queue latch;
+   * the queue is only worth broadcasting if this returns non-zero.
+   * @return number of requests newly granted
+   */
+  auto GrantNewRequests(LockRequestQueue *lock_request_queue) -> size_t;
 
   /**
    * Acquire a lock on rid in the given lock_mode.
@@ -256,6 +356,21 @@ class LockManager {
    */
   auto LockRow(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const RID &rid) -> bool;
 
+  /**
+   * Acquire locks on a batch of rows of the same table in the given lock_mode.
+   * Semantically identical to calling LockRow for each RID in order, but the
+   * request-queue lookups are grouped by lock-map shard so each shard's latch
+   * is taken once per batch instead of once per row. Intended for
+   * page-at-a-time scans that lock a whole page's rows back to back.
+   *
+   * @param txn the transaction requesting the locks
+   * @param lock_mode the lock mode for the requested locks
+   * @param oid the table_oid_t of the table the rows belong to
+   * @param rids the RIDs of the rows to be locked
+   * @return true if all locks were acquired, false as soon as one fails
+   */
+  auto LockRows(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const std::vector<RID> &rids) -> bool;
+
   /**
    * Release the lock held on a row by the transaction.
    *
@@ -280,6 +395,23 @@ class LockManager {
    */
   auto AddEdge(txn_id_t t1, txn_id_t t2) -> void;
 
+  /** One request copied out of a queue by the detector; the graph is built
+   * from these snapshots after the queue latch has been released. */
+  struct SnapshotRequest {
+    txn_id_t txn_id_;
+    LockMode lock_mode_;
+    bool granted_;
+  };
+
+  /**
+   * Collect waits-for edges for one queue snapshot into *edges: each
+   * ungranted request gets edges to the holders of exactly the modes it
+   * conflicts with, instead of a full (waiter, holder) cross product. Writes
+   * only to the out-parameter, so shard collection tasks can run in parallel.
+   */
+  static void BuildWaitEdges(const std::vector<SnapshotRequest> &requests, uint8_t granted_modes_bits,
+                             std::vector<std::pair<txn_id_t, txn_id_t>> *edges);
+
   /**
    * Removes an edge from t1 -> t2 from waits for graph.
    * @param t1 transaction waiting for a lock
@@ -293,7 +425,16 @@ class LockManager {
    * @return false if the graph has no cycle, otherwise stores the newest transaction ID in the cycle to txn_id
    */
 
-  auto SearchCycle(std::unordered_set<txn_id_t> &isvisited, txn_id_t cur, std::vector<txn_id_t> &ans) -> bool;
+  /** Dense CSR view of waits_for_, rebuilt by each HasCycle call: vertices
+   * are sorted txn ids, edges hold dense neighbour indices, and the DFS path
+   * state becomes flat arrays instead of hash probes per step. */
+  struct WaitGraphCsr {
+    std::vector<txn_id_t> verts_;
+    std::vector<size_t> offsets_;
+    std::vector<uint32_t> edges_;
+  };
+
+  auto SearchCycle(const WaitGraphCsr &csr, uint32_t start, std::vector<txn_id_t> &ans) -> bool;
 
   auto HasCycle(txn_id_t *txn_id) -> bool;
 
@@ -309,15 +450,36 @@ class LockManager {
 
  private:
   /** Fall 2022 */
-  /** Structure that holds lock requests for a given table oid */
-  std::unordered_map<table_oid_t, std::shared_ptr<LockRequestQueue>> table_lock_map_;
-  /** Coordination */
-  std::mutex table_lock_map_latch_;
-
-  /** Structure that holds lock requests for a given RID */
-  std::unordered_map<RID, std::shared_ptr<LockRequestQueue>> row_lock_map_;
-  /** Coordination */
-  std::mutex row_lock_map_latch_;
+  /** Number of partitions of each lock map. The map latch is only held to find
+   * or create a queue, so unrelated tables/rows hashing to different
+   * partitions never serialize on the same latch. */
+  static constexpr size_t NUM_LOCK_MAP_SHARDS = 16;
+
+  /** One partition of a lock map: a latch plus the queues it owns. The map is
+   * written only on the first lock of a key and read on every lock/unlock, so
+   * the latch is a reader-writer lock: lookups take it shared and only the
+   * one-time queue creation takes it exclusive. */
+  template <typename KeyType>
+  struct LockMapShard {
+    std::shared_mutex latch_;
+    std::unordered_map<KeyType, std::shared_ptr<LockRequestQueue>> map_;
+  };
+
+  /** Structure that holds lock requests for a given table oid, partitioned by oid hash */
+  std::array<LockMapShard<table_oid_t>, NUM_LOCK_MAP_SHARDS> table_lock_shards_;
+
+  /** Structure that holds lock requests for a given RID, partitioned by rid hash */
+  std::array<LockMapShard<RID>, NUM_LOCK_MAP_SHARDS> row_lock_shards_;
+
+  /** @return the partition holding the queue for the given table */
+  auto TableShard(const table_oid_t &oid) -> LockMapShard<table_oid_t> & {
+    return table_lock_shards_[std::hash<table_oid_t>{}(oid) % NUM_LOCK_MAP_SHARDS];
+  }
+
+  /** @return the partition holding the queue for the given row */
+  auto RowShard(const RID &rid) -> LockMapShard<RID> & {
+    return row_lock_shards_[std::hash<RID>{}(rid) % NUM_LOCK_MAP_SHARDS];
+  }
 
   std::atomic<bool> enable_cycle_detection_;
   std::thread *cycle_detection_thread_;
@@ -17,9 +17,13 @@
 
 #pragma once
 
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <shared_mutex>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -27,6 +31,31 @@
 
 namespace bustub {
 
+/**
+ * Key hashing for the extendible hash table. Integer keys keep std::hash
+ * (identity, which also keeps directory splits deterministic), but pointer
+ * keys get a 64-bit finalizer: raw pointers are 8-byte aligned, so their low
+ * three bits are always zero and the identity hash would leave 7 of every 8
+ * directory slots unreachable until the depth outgrows the alignment bits.
+ */
+template <typename K>
+struct EHTHash {
+  auto operator()(const K &key) const -> size_t { return std::hash<K>()(key); }
+};
+
+template <typename T>
+struct EHTHash<T *> {
+  auto operator()(T *key) const -> size_t {
+    auto x = reinterpret_cast<uint64_t>(key);
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+  }
+};
+
 /**
  * ExtendibleHashTable implements a hash table using the extendible hashing algorithm.
  * @tparam K key type
@@ -44,6 +73,22 @@ class ExtendibleHashTable : public HashTable<K, V> {
    */
   explicit ExtendibleHashTable(size_t bucket_size);
 
+  /**
+   * @brief Create a table whose directory starts at 2^initial_global_depth
+   * entries, each pointing at its own bucket. Callers that know a size bound
+   * (e.g. a pool of N entries needs depth ~log2(N / bucket_size)) skip the
+   * first initial_global_depth rounds of directory doubling during warm-up.
+   */
+  ExtendibleHashTable(size_t bucket_size, int initial_global_depth);
+
+  /**
+   * @brief Grow the directory once to fit an estimated number of keys,
+   * replacing the log2(n) doubling/re-copy rounds Insert would otherwise
+   * perform while the table warms up. Existing buckets and their local
+   * depths are untouched; new slots mirror the current directory.
+   */
+  void Reserve(size_t estimated_keys);
+
   /**
    * @brief Get the global depth of the directory.
    * @return The global depth of the directory.
@@ -77,6 +122,21 @@ class ExtendibleHashTable : public HashTable<K, V> {
    */
   auto Find(const K &key, V &value) -> bool override;
 
+  /**
+   * @brief Look up a batch of keys in one call.
+   *
+   * Hashes the whole batch first and prefetches each key's directory slot and
+   * bucket before probing, so the cache misses of up to 64 independent
+   * lookups overlap instead of serializing through one hash->slot->bucket
+   * dependency chain per key.
+   *
+   * @param keys The keys to be searched.
+   * @param[out] values values[i] receives the value for keys[i] if found.
+   * @param[out] found found[i] is 1 if keys[i] was found, 0 otherwise.
+   * @param n The number of keys.
+   */
+  void FindBatch(const K *keys, V *values, uint8_t *found, size_t n);
+
   /**
    *
    * TODO(P1): Add implementation
@@ -113,7 +173,7 @@ class ExtendibleHashTable : public HashTable<K, V> {
     explicit Bucket(size_t size, int depth = 0);
 
     /** @brief Check if a bucket is full. */
-    inline auto IsFull() const -> bool { return list_.size() == size_; }
+    inline auto IsFull() const -> bool { return items_.size() == size_; }
 
     /** @brief Get the local depth of the bucket. */
     inline auto GetDepth() const -> int { return depth_; }
@@ -123,7 +183,7 @@ class ExtendibleHashTable : public HashTable<K, V> {
 
     auto IndexOf(const K &key) const -> int;
 
-    inline auto GetItems() -> std::list<std::pair<K, V>> & { return list_; }
+    inline auto GetItems() -> std::vector<std::pair<K, V>> & { return items_; }
 
     /**
      *
@@ -159,11 +219,19 @@ class ExtendibleHashTable : public HashTable<K, V> {
      */
     auto Insert(const K &key, const V &value) -> bool;
 
+    /** Guards items_. Always taken after the directory latch; exclusive
+     * directory holders own every bucket implicitly (bucket latches are only
+     * ever held together with a shared directory latch) and skip this. */
+    std::shared_mutex latch_;
+
    private:
     // TODO(student): You may add additional private members and helper functions
     size_t size_;
     int depth_;
-    std::list<std::pair<K, V>> list_;
+    /** Entries stored contiguously (capacity reserved once at size_), so the
+     * linear probes in Find/Insert/Remove walk one or two cache lines instead
+     * of chasing list nodes, and no allocation happens per insert/remove. */
+    std::vector<std::pair<K, V>> items_;
   };
 
  private:
@@ -173,8 +241,16 @@ class ExtendibleHashTable : public HashTable<K, V> {
   int global_depth_;    // The global depth of the directory
   size_t bucket_size_;  // The size of a bucket
   int num_buckets_;     // The number of buckets in the hash table
-  mutable std::mutex latch_;
-  std::vector<std::shared_ptr<Bucket>> dir_;  // The directory of the hash table
+  // Reader-writer directory latch: lookups and per-bucket operations take it
+  // shared (the bucket latch serializes the bucket itself), and only the
+  // split/grow path in Insert takes it exclusive.
+  mutable std::shared_mutex latch_;
+  // Buckets live in a deque slab (pointer-stable growth, one allocation per
+  // chunk instead of one per bucket plus a shared_ptr control block), and the
+  // directory stores raw 8-byte pointers into it. Split-off buckets are never
+  // destroyed before the table, so no ownership tracking is needed.
+  std::deque<Bucket> bucket_store_;
+  std::vector<Bucket *> dir_;  // The directory of the hash table
 
   // The following functions are completely optional, you can delete them if you have your own ideas.
 
@@ -182,7 +258,7 @@ class ExtendibleHashTable : public HashTable<K, V> {
    * @brief Redistribute the kv pairs in a full bucket.
    * @param bucket The bucket to be redistributed.
    */
-  auto RedistributeBucket(std::shared_ptr<Bucket> bucket) -> void;
+  auto RedistributeBucket(Bucket *bucket) -> void;
 
   /*****************************************************************
    * Must acquire latch_ first before calling the below functions. *
@@ -193,7 +269,16 @@ class ExtendibleHashTable : public HashTable<K, V> {
    * @param key The key to be hashed.
    * @return The entry index in the directory.
    */
-  auto IndexOf(const K &key) -> size_t;
+  // Defined inline: IndexOf sits on every probe path, and for the integer
+  // and pointer keys this table is instantiated with the whole hash+mask
+  // folds to a couple of instructions once visible to the caller.
+  auto IndexOf(const K &key) -> size_t { return IndexOfHash(EHTHash<K>()(key)); }
+
+  /**
+   * @brief Directory index for an already-computed hash, so loops that probe
+   * several times for the same key hash it only once.
+   */
+  auto IndexOfHash(size_t hash) const -> size_t { return hash & ((static_cast<size_t>(1) << global_depth_) - 1); }
 
   auto GetGlobalDepthInternal() const -> int;
   auto GetLocalDepthInternal(int dir_index) const -> int;
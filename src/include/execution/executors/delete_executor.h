@@ -63,5 +63,10 @@ class DeleteExecutor : public AbstractExecutor {
   /** The child executor from which RIDs for deleted tuples are pulled */
   std::unique_ptr<AbstractExecutor> child_executor_;
   std::vector<RID> remove_tuples_;
+  /** Scratch buffer for index key values, reused across rows to avoid a per-row allocation */
+  std::vector<Value> key_values_;
+  /** Catalog entries resolved once in Init() instead of per deleted row */
+  TableInfo *table_info_{nullptr};
+  std::vector<IndexInfo *> index_infos_;
 };
 }  // namespace bustub
@@ -62,6 +62,11 @@ class InsertExecutor : public AbstractExecutor {
   bool flag_;
   std::unique_ptr<AbstractExecutor> child_executor_;
   std::vector<RID> insert_recode_;
+  /** Scratch buffer for index key values, reused across rows to avoid a per-row allocation */
+  std::vector<Value> key_values_;
+  /** Catalog entries resolved once in Init() instead of per inserted row */
+  TableInfo *table_info_{nullptr};
+  std::vector<IndexInfo *> index_infos_;
 };
 
 }  // namespace bustub
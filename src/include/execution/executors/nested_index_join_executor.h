@@ -53,7 +53,22 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   const NestedIndexJoinPlanNode *plan_;
 
   std::unique_ptr<AbstractExecutor> child_executor_;
-  std::vector<Tuple> result_;
+  /**
+   * One output row in unassembled form: the materialized outer tuple plus the
+   * RID of the matching inner row (has_right_ is false for the null-padded
+   * LEFT rows). Next() concatenates on demand, so Init materializes roughly
+   * half the bytes a vector of assembled tuples would.
+   */
+  struct OutRow {
+    Tuple left_;
+    RID right_rid_;
+    bool has_right_;
+  };
+  std::vector<OutRow> result_;
+  /** Inner table, resolved once in Init() and used by Next() to fetch matches */
+  TableInfo *inner_table_{nullptr};
+  /** Scratch buffer for assembling output values in Next() */
+  std::vector<Value> values_;
   size_t index_;
 };
 }  // namespace bustub
@@ -55,12 +55,29 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); };
 
  private:
+  /** @return The concatenated output tuple; right == nullptr pads the right side with nulls */
+  auto MakeOutput(const Tuple &left, const Tuple *right) -> Tuple;
+
   /** The NestedLoopJoin plan node to be executed. */
   const NestedLoopJoinPlanNode *plan_;
   std::unique_ptr<AbstractExecutor> left_executor_;
   std::unique_ptr<AbstractExecutor> right_executor_;
-  std::vector<Tuple> result_;
-  size_t index_;
+  /** Both inputs materialized once in Init(); the join itself streams. */
+  std::vector<Tuple> left_tuples_;
+  std::vector<Tuple> right_tuples_;
+  /** Per-left-row match flags, accumulated across right blocks for LEFT join */
+  std::vector<bool> matched_;
+  /** Resumable cursor of the tiled join: current block origins (lb_, rb_) and
+   * the probe position (li_, ri_) inside them. */
+  size_t lb_;
+  size_t rb_;
+  size_t li_;
+  size_t ri_;
+  /** True while draining the null-padded LEFT rows of the finished left block */
+  bool emitting_nulls_;
+  size_t null_li_;
+  /** Scratch buffer for assembling output values */
+  std::vector<Value> values_;
 };
 
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <utility>
 #include <vector>
 
 #include "execution/executor_context.h"
@@ -49,9 +50,21 @@ class SeqScanExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); }
 
  private:
+  /** 把下一页存活元组整批拷进page_buf_，空表/扫完返回false */
+  auto FillNextPage() -> bool;
+
   /** The sequential scan plan node to be executed */
   const SeqScanPlanNode *plan_;
 
-  TableIterator iterator_;
+  /** 构造时查一次catalog缓存下来，Next不再每行做目录哈希查找 */
+  TableInfo *table_info_;
+
+  /** page_buf_之后要扫的页 */
+  page_id_t next_page_id_;
+  /** 一页的存活元组在一次页闩锁下整批拷出，Next逐个发回 */
+  std::vector<std::pair<Tuple, RID>> page_buf_;
+  size_t page_pos_{0};
+  /** Init真拿到了IS表锁才置位；已有更强表锁时不拿也不解 */
+  bool took_table_lock_{false};
 };
 }  // namespace bustub
@@ -54,6 +54,8 @@ class SortExecutor : public AbstractExecutor {
   const SortPlanNode *plan_;
   std::unique_ptr<AbstractExecutor> child_executor_;
   std::vector<Tuple> tuples_;
+  /** Sorted permutation into tuples_; the tuple store itself never moves */
+  std::vector<uint32_t> order_;
   size_t index_;
 };
 }  // namespace bustub
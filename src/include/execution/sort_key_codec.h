@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// sort_key_codec.h
+//
+// Identification: src/include/execution/sort_key_codec.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "type/value.h"
+
+namespace bustub {
+
+/** 能无损映射到uint64且保序的定宽排序键类型，Sort/TopN共用 */
+inline auto SurrogateSortable(TypeId type) -> bool {
+  switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+    case TypeId::SMALLINT:
+    case TypeId::INTEGER:
+    case TypeId::BIGINT:
+    case TypeId::DECIMAL:
+    case TypeId::TIMESTAMP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** 保序编码：f(a)<f(b) 当且仅当 a<b，相等当且仅当Value相等 */
+inline auto SurrogateKey(const Value &v) -> uint64_t {
+  switch (v.GetTypeId()) {
+    case TypeId::BOOLEAN:
+      return static_cast<uint64_t>(v.GetAs<int8_t>()) ^ (1ULL << 63);
+    case TypeId::TINYINT:
+      return static_cast<uint64_t>(static_cast<int64_t>(v.GetAs<int8_t>())) ^ (1ULL << 63);
+    case TypeId::SMALLINT:
+      return static_cast<uint64_t>(static_cast<int64_t>(v.GetAs<int16_t>())) ^ (1ULL << 63);
+    case TypeId::INTEGER:
+      return static_cast<uint64_t>(static_cast<int64_t>(v.GetAs<int32_t>())) ^ (1ULL << 63);
+    case TypeId::BIGINT:
+      return static_cast<uint64_t>(v.GetAs<int64_t>()) ^ (1ULL << 63);
+    case TypeId::DECIMAL: {
+      double d = v.GetAs<double>();
+      if (d == 0.0) {
+        d = 0.0;  // -0.0和0.0比较相等，归一化成同一编码
+      }
+      uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      // 负数翻转全部位（绝对值越大越小），非负数只翻符号位
+      return ((bits >> 63) != 0) ? ~bits : bits | (1ULL << 63);
+    }
+    case TypeId::TIMESTAMP:
+      return v.GetAs<uint64_t>();
+    default:
+      return 0;
+  }
+}
+
+/** 能无损映射到uint32且保序的窄定宽类型：替代键连同元组下标可打包进
+ * 一个uint64，排序流只剩一条稠密数组 */
+inline auto Surrogate32Sortable(TypeId type) -> bool {
+  switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+    case TypeId::SMALLINT:
+    case TypeId::INTEGER:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** 32位保序编码，与SurrogateKey同一套约定 */
+inline auto SurrogateKey32(const Value &v) -> uint32_t {
+  switch (v.GetTypeId()) {
+    case TypeId::BOOLEAN:
+      return static_cast<uint32_t>(v.GetAs<int8_t>()) ^ (1U << 31);
+    case TypeId::TINYINT:
+      return static_cast<uint32_t>(static_cast<int32_t>(v.GetAs<int8_t>())) ^ (1U << 31);
+    case TypeId::SMALLINT:
+      return static_cast<uint32_t>(static_cast<int32_t>(v.GetAs<int16_t>())) ^ (1U << 31);
+    case TypeId::INTEGER:
+      return static_cast<uint32_t>(v.GetAs<int32_t>()) ^ (1U << 31);
+    default:
+      return 0;
+  }
+}
+
+}  // namespace bustub
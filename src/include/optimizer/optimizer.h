@@ -97,6 +97,17 @@ class Optimizer {
    */
   auto OptimizeSortLimitAsTopN(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
+  /**
+   * @brief 节点保证的输出顺序：Sort/TopN是自己的order-by，单列键的
+   * IndexScan是键列升序，其余节点为空（不保证顺序）
+   */
+  auto OutputOrdering(const AbstractPlanNodeRef &plan) -> std::vector<std::pair<OrderByType, AbstractExpressionRef>>;
+
+  /**
+   * @brief 子计划输出已按需求有序时删掉Sort、把TopN退化成Limit
+   */
+  auto OptimizeRedundantSort(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+
   /**
    * @brief get the estimated cardinality for a table based on the table name. Useful when join reordering. BusTub
    * doesn't support statistics for now, so it's the only way for you to get the table size :(
@@ -12,10 +12,11 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -52,6 +53,8 @@ class TrieNode {
   TrieNode(TrieNode &&other_trie_node) noexcept
       : key_char_(other_trie_node.GetKeyChar()), is_end_(other_trie_node.IsEndNode()) {
     children_ = std::move(other_trie_node.children_);
+    child_count_ = other_trie_node.child_count_;
+    other_trie_node.child_count_ = 0;
   }
 
   /**
@@ -67,11 +70,7 @@ class TrieNode {
    * @param key_char Key char of child node.
    * @return True if this trie node has a child with given key, false otherwise.
    */
-  bool HasChild(char key_char) const {
-    auto it = children_.find(key_char);
-
-    return it != children_.end();
-  }
+  bool HasChild(char key_char) const { return children_[static_cast<unsigned char>(key_char)] != nullptr; }
 
   /**
    * TODO(P0): Add implementation
@@ -81,7 +80,7 @@ class TrieNode {
    *
    * @return True if this trie node has any child node, false if it has no child node.
    */
-  bool HasChildren() const { return !children_.empty(); }
+  bool HasChildren() const { return child_count_ > 0; }
 
   /**
    * TODO(P0): Add implementation
@@ -121,10 +120,11 @@ class TrieNode {
    * @return Pointer to unique_ptr of the inserted child node. If insertion fails, return nullptr.
    */
   std::unique_ptr<TrieNode> *InsertChildNode(char key_char, std::unique_ptr<TrieNode> &&child) {
-    auto it = children_.find(key_char);
-    if (it == children_.end() && key_char == child->GetKeyChar()) {
-      children_[key_char] = std::move(child);
-      return &children_[key_char];
+    auto &slot = children_[static_cast<unsigned char>(key_char)];
+    if (slot == nullptr && key_char == child->GetKeyChar()) {
+      slot = std::move(child);
+      ++child_count_;
+      return &slot;
     }
 
     return nullptr;
@@ -141,12 +141,8 @@ class TrieNode {
    *         node does not exist.
    */
   std::unique_ptr<TrieNode> *GetChildNode(char key_char) {
-    auto it = children_.find(key_char);
-    if (it != children_.end()) {
-      return &it->second;
-    }
-
-    return nullptr;
+    auto &slot = children_[static_cast<unsigned char>(key_char)];
+    return slot != nullptr ? &slot : nullptr;
   }
 
   /**
@@ -158,9 +154,10 @@ class TrieNode {
    * @param key_char Key char of child node to be removed
    */
   void RemoveChildNode(char key_char) {
-    auto it = children_.find(key_char);
-    if (it != children_.end()) {
-      children_.erase(it);
+    auto &slot = children_[static_cast<unsigned char>(key_char)];
+    if (slot != nullptr) {
+      slot.reset();
+      --child_count_;
     }
   }
 
@@ -178,9 +175,11 @@ class TrieNode {
   char key_char_;
   /** whether this node marks the end of a key */
   bool is_end_{false};
-  /** A map of all child nodes of this trie node, which can be accessed by each
-   * child node's key char. */
-  std::unordered_map<char, std::unique_ptr<TrieNode>> children_;
+  /** Child nodes indexed directly by key char: one indexed load per lookup
+   * instead of a hash, bucket walk and key compare on every traversal step. */
+  std::array<std::unique_ptr<TrieNode>, 256> children_{};
+  /** Number of non-null slots in children_, so HasChildren stays O(1). */
+  uint16_t child_count_{0};
 };
 
 /**
@@ -58,6 +58,19 @@ class DiskManager {
    */
   virtual void ReadPage(page_id_t page_id, char *page_data);
 
+  /**
+   * Write a dirty victim page out and read its replacement into the same
+   * buffer in one call. Used by the buffer pool on a page fault that evicts a
+   * dirty frame, so the two dependent I/Os are issued as one chained request.
+   * @param write_page_id id of the dirty page being written out
+   * @param read_page_id id of the page being faulted in
+   * @param page_data buffer holding the victim's data; receives the new page
+   */
+  virtual void SwapPage(page_id_t write_page_id, page_id_t read_page_id, char *page_data) {
+    WritePage(write_page_id, page_data);
+    ReadPage(read_page_id, page_data);
+  }
+
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
@@ -99,9 +112,12 @@ class DiskManager {
   std::string log_name_;
   // stream to write db file
   std::fstream db_io_;
+  // file descriptor for positional page I/O (pread/pwrite), so concurrent
+  // page reads and writes need neither a shared cursor nor a latch
+  int db_fd_{-1};
   std::string file_name_;
-  int num_flushes_{0};
-  int num_writes_{0};
+  std::atomic<int> num_flushes_{0};
+  std::atomic<int> num_writes_{0};
   bool flush_log_{false};
   std::future<void> *flush_log_f_{nullptr};
   // With multiple buffer pool instances, need to protect file access
@@ -10,8 +10,10 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
 #include <mutex>  // NOLINT
 #include <queue>
+#include <shared_mutex>  // NOLINT
 #include <string>
 #include <vector>
 
@@ -45,10 +47,20 @@ class BPlusTree {
                      int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
 
   // Returns true if this B+ tree has no keys and values.
-  auto IsEmpty() const -> bool;
+  auto IsEmpty() const -> bool { return root_page_id_.load(std::memory_order_relaxed) == INVALID_PAGE_ID; }
 
   auto FindLeaf(const KeyType &key) -> LeafPage *;
 
+  /** 写路径下行：祖先保持pin并连同走向孩子的下标压进path_，
+   * 分裂/合并上行时直接弹栈，不再FetchPage父页也不再线性扫孩子下标 */
+  auto FindLeafPath(const KeyType &key) -> LeafPage *;
+
+  /** 把path_里还没被上行流程消费的祖先按未脏解pin */
+  void ReleasePath();
+
+  /** 内部结点里第一个大于key的下标（无则GetSize()），无分支二分 */
+  auto UpperBound(InternalPage *internal, const KeyType &key) const -> int;
+
   void InsertInParent(BPlusTreePage *left, BPlusTreePage *right, const KeyType &key);
 
   // Insert a key-value pair into this B+ tree.
@@ -63,7 +75,7 @@ class BPlusTree {
   auto GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr) -> bool;
 
   // return the page id of the root node
-  auto GetRootPageId() -> page_id_t;
+  auto GetRootPageId() -> page_id_t { return root_page_id_.load(std::memory_order_acquire); }
 
   // index iterator
   auto Begin() -> INDEXITERATOR_TYPE;
@@ -76,6 +88,10 @@ class BPlusTree {
   // draw the B+ tree
   void Draw(BufferPoolManager *bpm, const std::string &outf);
 
+  /** 空树上的自底向上批量建树：有序kv按页切段直接memcpy成叶子链，
+   * 再逐层用每段首键建内部层，零分裂零下行查找 */
+  void BulkLoad(const std::vector<MappingType> &sorted_kv);
+
   // read data from file and insert one by one
   void InsertFromFile(const std::string &file_name, Transaction *transaction = nullptr);
 
@@ -83,22 +99,70 @@ class BPlusTree {
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
 
  private:
+  /** FindLeafPath记下的一层：已pin的内部结点和下行走的孩子下标 */
+  struct DescentFrame {
+    InternalPage *page_;
+    int child_index_;
+  };
+
   void UpdateRootPageId(int insert_record = 0);
 
+  /** FetchPage+reinterpret_cast的统一写法；返回前先把页头行预取进L1，
+   * 紧跟着的IsLeafPage()/GetSize()不吃FetchPage刚带回的冷miss */
+  template <typename T>
+  auto FetchAs(page_id_t page_id) -> T * {
+    char *data = buffer_pool_manager_->FetchPage(page_id)->GetData();
+    __builtin_prefetch(data, 0, 3);
+    return reinterpret_cast<T *>(data);
+  }
+
+  /** 把本次Remove攒下的待删页一次性交给缓冲池批删，并记入事务删除集 */
+  void FlushPendingDeletes(Transaction *transaction);
+
+  /** 释放根页常驻pin（删根页前必须先放，否则DeletePage失败） */
+  void DropRootCache();
+  /** 换根后重建常驻pin，读下行从此拿现成指针起步 */
+  void RefreshRootCache();
+
   /* Debug Routines for FREE!! */
-  void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
+  void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::string &buf) const;
 
   void ToString(BPlusTreePage *page, BufferPoolManager *bpm) const;
 
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  /** 原子根页id：换根store(release)、入口load一次当局部量用，
+   * 根分裂期间旁观者不会读到撕裂值，IsEmpty也不用抢树闩 */
+  std::atomic<page_id_t> root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
 
-  std::mutex latch_;
+  /** 本树在header页里的记录下标缓存，换根写回时免去按名strcmp线性扫 */
+  int header_record_index_{-1};
+
+  /** 根页常驻pin：树自己押着一个pin让根页不被换出，点查下行起步
+   * 不再为最热的一页做FetchPage哈希查找。只在独占树闩下换，读者
+   * 持共享闩时指针稳定 */
+  Page *cached_root_page_{nullptr};
+
+  /** 最左叶子页id缓存：Begin()一次FetchPage直达，不再O(height)下行。
+   * 全树最左叶子在每层下标都是0、没有左兄弟，合并永远不会删它，
+   * 只在建树/清空时变；同样只在独占树闩下改 */
+  page_id_t leftmost_leaf_page_id_{INVALID_PAGE_ID};
+
+  /** 最近一次FindLeafPath收集的祖先链，写者独占latch_下使用 */
+  std::vector<DescentFrame> path_;
+
+  /** 本次Remove合并掉的页，攒着出口一把批删，不逐页抢缓冲池闩；
+   * 同path_一样只在独占latch_下使用 */
+  std::vector<page_id_t> pending_deletes_;
+
+  /** 读写树闩：查找/迭代器入口共享，Insert/Remove独占。点查互相不再
+   * 串行，读多写少负载下吞吐随核数扩展；页粒度crabbing需要整个写路径
+   * 放弃父指针递归，另行处理 */
+  std::shared_mutex latch_;
 };
 
 }  // namespace bustub
@@ -16,6 +16,7 @@
 
 #include "common/logger.h"
 #include "storage/table/tuple.h"
+#include "type/limits.h"
 #include "type/value.h"
 
 namespace bustub {
@@ -77,7 +78,32 @@ class GenericKey {
 template <size_t KeySize>
 class GenericComparator {
  public:
-  inline auto operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const -> int {
+  // 定义就在头里，下行二分/叶内查找的调用点都看得到函数体；always_inline
+  // 保证快路径不退化成函数调用，整数比较直接融进热循环
+  __attribute__((always_inline)) inline auto operator()(const GenericKey<KeySize> &lhs,
+                                                        const GenericKey<KeySize> &rhs) const -> int {
+    // 单整数列键的快路径：直接按原始字节比大小，不再为每次比较构造两个
+    // Value再走类型分发。B+树结点内的键扫描是纯比较开销，省掉Value后
+    // 热循环只剩load和整数比较。NULL哨兵值的比较语义由Value定义（互相
+    // “相等”），碰到就退回慢路径
+    if (fast_type_ == TypeId::BIGINT) {
+      int64_t l;
+      int64_t r;
+      memcpy(&l, lhs.data_ + fast_offset_, sizeof(l));
+      memcpy(&r, rhs.data_ + fast_offset_, sizeof(r));
+      if (l != BUSTUB_INT64_NULL && r != BUSTUB_INT64_NULL) {
+        return static_cast<int>(l > r) - static_cast<int>(l < r);
+      }
+    } else if (fast_type_ == TypeId::INTEGER) {
+      int32_t l;
+      int32_t r;
+      memcpy(&l, lhs.data_ + fast_offset_, sizeof(l));
+      memcpy(&r, rhs.data_ + fast_offset_, sizeof(r));
+      if (l != BUSTUB_INT32_NULL && r != BUSTUB_INT32_NULL) {
+        return static_cast<int>(l > r) - static_cast<int>(l < r);
+      }
+    }
+
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -95,13 +121,27 @@ class GenericComparator {
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_}, fast_type_{other.fast_type_}, fast_offset_{other.fast_offset_} {}
 
   // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {
+    // 构造时判一次快路径资格，operator()里只剩一个可预测的类型分支
+    if (key_schema_ != nullptr && key_schema_->GetColumnCount() == 1) {
+      const auto &col = key_schema_->GetColumn(0);
+      if (col.IsInlined() && (col.GetType() == TypeId::BIGINT || col.GetType() == TypeId::INTEGER) &&
+          col.GetOffset() + col.GetFixedLength() <= KeySize) {
+        fast_type_ = col.GetType();
+        fast_offset_ = col.GetOffset();
+      }
+    }
+  }
 
  private:
   Schema *key_schema_;
+  /** 键模式是单个内联整数列时的列类型，否则INVALID走通用路径 */
+  TypeId fast_type_{TypeId::INVALID};
+  uint32_t fast_offset_{0};
 };
 
 }  // namespace bustub
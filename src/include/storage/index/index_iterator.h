@@ -31,7 +31,7 @@ class IndexIterator {
 
   auto IsEnd() -> bool;
 
-  auto operator*() -> const MappingType &;
+  auto operator*() -> MappingType;
 
   auto operator++() -> IndexIterator &;
 
@@ -40,10 +40,19 @@ class IndexIterator {
   auto operator!=(const IndexIterator &itr) const -> bool { return !(itr.iter_ == iter_ && itr.index_ == index_); }
 
  private:
+  /** 换页时重建基址/大小/后继缓存，步进就只剩++index_ */
+  void CacheLeaf();
+
   // add your own private member variables here
   BufferPoolManager *buffer_pool_manager_;
   LeafPage *iter_;
   int index_;
+
+  // 当前叶子的数组基址等缓存，免去逐元素走访问器
+  const KeyType *key_base_{nullptr};
+  const ValueType *value_base_{nullptr};
+  int size_{0};
+  page_id_t next_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
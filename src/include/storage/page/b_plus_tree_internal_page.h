@@ -27,9 +27,11 @@ namespace bustub {
  * the first key always remains invalid. That is to say, any search/lookup
  * should ignore the first key.
  *
- * Internal page format (keys are stored in increasing order):
+ * Internal page format (keys are stored in increasing order, keys and child
+ * page ids split into two parallel arrays so the binary search over keys
+ * touches contiguous key bytes only):
  *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
+ * | HEADER | KEY(1) ... KEY(max) | PAGE_ID(0) ... PAGE_ID(max-1) |
  *  --------------------------------------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
@@ -38,19 +40,41 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   // must call initialize method after "create" a new node
   void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE);
 
-  auto KeyAt(int index) const -> KeyType;
+  // 返回常引用，同叶子页：免去宽键逐探测的整键拷贝
+  auto KeyAt(int index) const -> const KeyType &;
   void SetKeyAt(int index, const KeyType &key);
   auto ValueAt(int index) const -> ValueType;
   void SetValueAt(int index, const ValueType &value);
 
+  // 下行二分用的键数组基址，SoA布局下键是连续的一段
+  auto KeyBase() const -> const KeyType * { return Keys(); }
+
   auto FindKey(const KeyType &key, const KeyComparator &comparator) -> int;
   void PushKey(const KeyType &key, const ValueType &value, const KeyComparator &comparator);
   void DeleteWithValue(const ValueType &value);
+  /** 下标已知（下行path_记着）时直接按位删，免按值线性扫 */
+  void DeleteAt(int index);
 
   void PushForward();
 
+  /** 把src的键值[from,to)整段memcpy到本页尾部，调用方保证有序衔接；
+   * 接缝处的第一个键来自src的0号无效键，需要调用方SetKeyAt补分隔键 */
+  void AppendSortedRange(const BPlusTreeInternalPage *src, int from, int to);
+  /** 同上，但源是分裂时攒的pair临时数组 */
+  void AppendSortedRange(const MappingType *kvs, int from, int to);
+
  private:
-  // Flexible array member for page data.
-  MappingType array_[1];
+  // SoA布局：同叶子页，下行二分只拉键数组。值数组基址由GetMaxSize()定
+  auto Keys() -> KeyType * { return reinterpret_cast<KeyType *>(data_); }
+  auto Keys() const -> const KeyType * { return reinterpret_cast<const KeyType *>(data_); }
+  auto Values() -> ValueType * {
+    return reinterpret_cast<ValueType *>(data_ + static_cast<size_t>(GetMaxSize()) * sizeof(KeyType));
+  }
+  auto Values() const -> const ValueType * {
+    return reinterpret_cast<const ValueType *>(data_ + static_cast<size_t>(GetMaxSize()) * sizeof(KeyType));
+  }
+
+  // Flexible array member for page data: [keys...][values...]
+  char data_[1];
 };
 }  // namespace bustub
@@ -26,9 +26,10 @@ namespace bustub {
  * see include/common/rid.h for detailed implementation) together within leaf
  * page. Only support unique key.
  *
- * Leaf page format (keys are stored in order):
+ * Leaf page format (keys are stored in order, keys and values split into
+ * two parallel arrays so key-only scans touch contiguous key bytes):
  *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
+ * | HEADER | KEY(1) ... KEY(max) | RID(1) ... RID(max)
  *  ----------------------------------------------------------------------
  *
  *  Header format (size in byte, 28 bytes in total):
@@ -48,17 +49,41 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   // helper methods
   auto GetNextPageId() const -> page_id_t;
   void SetNextPageId(page_id_t next_page_id);
-  auto KeyAt(int index) const -> KeyType;
+  // 返回常引用：宽键（GenericKey<64>）按值返回时每次探测都整键拷贝
+  auto KeyAt(int index) const -> const KeyType &;
 
   auto FindKey(const KeyType &key, const KeyComparator &comparator) -> int;
   auto PushKey(const KeyType &key, const ValueType &value, const KeyComparator &comparator) -> bool;
   auto DeleteKey(const KeyType &key, const KeyComparator &comparator) -> int;
+  /** 下标已知时直接按位删，免去DeleteKey的二分再比较 */
+  void DeleteAt(int index);
   auto ValueAt(int index) const -> ValueType;
-  auto GetKeyValue(int index) -> const MappingType &;
+  auto GetKeyValue(int index) -> MappingType;
+
+  // 迭代器缓存的裸数组基址：SoA布局下范围扫描就是两条紧凑数组的顺序读
+  auto KeyBase() const -> const KeyType * { return Keys(); }
+  auto ValueBase() const -> const ValueType * { return Values(); }
+
+  /** 把src的[from,to)整段memcpy到本页尾部。调用方保证接上后仍有序，
+   * 分裂/合并的源本来就有序，不必逐个PushKey再比较再挪 */
+  void AppendSortedRange(const BPlusTreeLeafPage *src, int from, int to);
+  /** 同上，但源是批量装载攒好的有序pair数组 */
+  void AppendSortedRange(const MappingType *kvs, int from, int to);
 
  private:
+  // SoA布局：键数组和值数组分开放，二分/点查只拉键字节，不再为每个槽
+  // 连带把RID也读进缓存。值数组基址由GetMaxSize()定，Init后才可用
+  auto Keys() -> KeyType * { return reinterpret_cast<KeyType *>(data_); }
+  auto Keys() const -> const KeyType * { return reinterpret_cast<const KeyType *>(data_); }
+  auto Values() -> ValueType * {
+    return reinterpret_cast<ValueType *>(data_ + static_cast<size_t>(GetMaxSize()) * sizeof(KeyType));
+  }
+  auto Values() const -> const ValueType * {
+    return reinterpret_cast<const ValueType *>(data_ + static_cast<size_t>(GetMaxSize()) * sizeof(KeyType));
+  }
+
   page_id_t next_page_id_;
-  // Flexible array member for page data.
-  MappingType array_[1];
+  // Flexible array member for page data: [keys...][values...]
+  char data_[1];
 };
 }  // namespace bustub
@@ -42,25 +42,29 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  */
 class BPlusTreePage {
  public:
-  auto IsLeafPage() const -> bool;
-  auto IsRootPage() const -> bool;
-  void SetPageType(IndexPageType page_type);
+  // 访问器定义全放头里：原来在.cpp里，热循环每圈的GetSize()都是一次
+  // 真函数调用，编译器没法CSE掉循环上界；内联后按普通字段读优化
+  auto IsLeafPage() const -> bool { return page_type_ == IndexPageType::LEAF_PAGE; }
+  auto IsRootPage() const -> bool { return parent_page_id_ == INVALID_PAGE_ID; }
+  void SetPageType(IndexPageType page_type) { page_type_ = page_type; }
 
-  auto GetSize() const -> int;
-  void SetSize(int size);
-  void IncreaseSize(int amount);
+  auto GetSize() const -> int { return size_; }
+  void SetSize(int size) { size_ = size; }
+  void IncreaseSize(int amount) { size_ += amount; }
 
-  auto GetMaxSize() const -> int;
-  void SetMaxSize(int max_size);
-  auto GetMinSize() const -> int;
+  auto GetMaxSize() const -> int { return max_size_; }
+  void SetMaxSize(int max_size) { max_size_ = max_size; }
+  auto GetMinSize() const -> int { return (max_size_ + 1) / 2; }
 
-  auto GetParentPageId() const -> page_id_t;
-  void SetParentPageId(page_id_t parent_page_id);
+  /** advisory：只在Init时写入，分裂/合并不再回写孩子的父指针。
+   * 父子关系以下行path_为准，判根比较root_page_id_，别依赖这个字段 */
+  auto GetParentPageId() const -> page_id_t { return parent_page_id_; }
+  void SetParentPageId(page_id_t parent_page_id) { parent_page_id_ = parent_page_id; }
 
-  auto GetPageId() const -> page_id_t;
-  void SetPageId(page_id_t page_id);
+  auto GetPageId() const -> page_id_t { return page_id_; }
+  void SetPageId(page_id_t page_id) { page_id_ = page_id; }
 
-  void SetLSN(lsn_t lsn = INVALID_LSN);
+  void SetLSN(lsn_t lsn = INVALID_LSN) { lsn_ = lsn; }
 
  private:
   // member variable, attributes that both internal and leaf page share
@@ -35,6 +35,8 @@ class HeaderPage : public Page {
   auto InsertRecord(const std::string &name, page_id_t root_id) -> bool;
   auto DeleteRecord(const std::string &name) -> bool;
   auto UpdateRecord(const std::string &name, page_id_t root_id) -> bool;
+  // update by record index, skips the per-name linear scan
+  auto UpdateRecordAt(int index, page_id_t root_id) -> bool;
 
   // return root_id if success
   auto GetRootId(const std::string &name, page_id_t *root_id) -> bool;
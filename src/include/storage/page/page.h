@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -25,7 +26,7 @@ namespace bustub {
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
  */
-class Page {
+class alignas(64) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
 
@@ -43,10 +44,10 @@ class Page {
   inline auto GetPageId() -> page_id_t { return page_id_; }
 
   /** @return the pin count of this page */
-  inline auto GetPinCount() -> int { return pin_count_; }
+  inline auto GetPinCount() -> int { return pin_count_.load(std::memory_order_acquire); }
 
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
-  inline auto IsDirty() -> bool { return is_dirty_; }
+  inline auto IsDirty() -> bool { return is_dirty_.load(std::memory_order_acquire); }
 
   /** Acquire the page write latch. */
   inline void WLatch() { rwlatch_.WLock(); }
@@ -78,16 +79,19 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, BUSTUB_PAGE_SIZE); }
 
-  /** The actual data that is stored within a page. */
-  char data_[BUSTUB_PAGE_SIZE]{};
+  // Hot book-keeping fields live together ahead of the data array, so pin and
+  // dirty-bit traffic on one frame never shares a cache line with another
+  // frame's page contents; the class alignment keeps frames line-aligned.
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /** The pin count of this page; atomic so unpinning does not need the BPM latch. */
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** The actual data that is stored within a page. */
+  alignas(64) char data_[BUSTUB_PAGE_SIZE]{};
 };
 
 }  // namespace bustub
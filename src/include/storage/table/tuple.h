@@ -12,7 +12,9 @@
 
 #pragma once
 
+#include <initializer_list>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "catalog/schema.h"
@@ -48,6 +50,30 @@ class Tuple {
   // assign operator, deep copy
   auto operator=(const Tuple &other) -> Tuple &;
 
+  // move constructor/assignment, steal the payload instead of copying it
+  Tuple(Tuple &&other) noexcept
+      : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_), data_(other.data_) {
+    other.allocated_ = false;
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  auto operator=(Tuple &&other) noexcept -> Tuple & {
+    if (this != &other) {
+      if (allocated_) {
+        delete[] data_;
+      }
+      allocated_ = other.allocated_;
+      rid_ = other.rid_;
+      size_ = other.size_;
+      data_ = other.data_;
+      other.allocated_ = false;
+      other.data_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
   ~Tuple() {
     if (allocated_) {
       delete[] data_;
@@ -77,6 +103,13 @@ class Tuple {
   // Generates a key tuple given schemas and attributes
   auto KeyFromTuple(const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs) -> Tuple;
 
+  // Concatenate source tuples into one output tuple in a single pass over the
+  // serialized bytes, skipping the deserialize-into-Values / re-serialize
+  // round trip. The output schema's columns must be the source schemas'
+  // columns in order (the shape of a join output schema).
+  static auto AssembleConcat(const Schema &out_schema,
+                             std::initializer_list<std::pair<const Tuple *, const Schema *>> srcs) -> Tuple;
+
   // Is the column value null ?
   inline auto IsNull(const Schema *schema, uint32_t column_idx) const -> bool {
     Value value = GetValue(schema, column_idx);
@@ -14,6 +14,9 @@ auto Optimizer::OptimizeCustom(const AbstractPlanNodeRef &plan) -> AbstractPlanN
   p = OptimizeNLJAsIndexJoin(p);
   // p = OptimizeNLJAsHashJoin(p);  // Enable this rule after you have implemented hash join.
   p = OptimizeOrderByAsIndexScan(p);
+  // 在TopN改写前跑：子计划已有序时Limit+Sort直接塌成Limit，而不是先变
+  // TopN再退化
+  p = OptimizeRedundantSort(p);
   p = OptimizeSortLimitAsTopN(p);
   return p;
 }
@@ -0,0 +1,102 @@
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "catalog/catalog.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/plans/index_scan_plan.h"
+#include "execution/plans/limit_plan.h"
+#include "execution/plans/sort_plan.h"
+#include "execution/plans/topn_plan.h"
+#include "optimizer/optimizer.h"
+
+namespace bustub {
+
+/** 两个排序要求等价：方向一致（DEFAULT按ASC算），表达式是同一列的列
+ * 引用。表达式树没有结构化相等接口，这里只认列引用，认不出来就当不等 */
+static auto SameOrderKey(OrderByType a_type, const AbstractExpression *a_expr, OrderByType b_type,
+                         const AbstractExpression *b_expr) -> bool {
+  auto norm = [](OrderByType t) { return t == OrderByType::DEFAULT ? OrderByType::ASC : t; };
+  if (norm(a_type) != norm(b_type)) {
+    return false;
+  }
+  const auto *a_col = dynamic_cast<const ColumnValueExpression *>(a_expr);
+  const auto *b_col = dynamic_cast<const ColumnValueExpression *>(b_expr);
+  return a_col != nullptr && b_col != nullptr && a_col->GetTupleIdx() == b_col->GetTupleIdx() &&
+         a_col->GetColIdx() == b_col->GetColIdx();
+}
+
+auto Optimizer::OutputOrdering(const AbstractPlanNodeRef &plan)
+    -> std::vector<std::pair<OrderByType, AbstractExpressionRef>> {
+  switch (plan->GetType()) {
+    case PlanType::Sort:
+      return static_cast<const SortPlanNode &>(*plan).GetOrderBy();
+    case PlanType::TopN:
+      return static_cast<const TopNPlanNode &>(*plan).GetOrderBy();
+    case PlanType::IndexScan: {
+      // B+树索引扫描按键升序吐行；单列键映射回表列的列引用
+      const auto &index_scan = static_cast<const IndexScanPlanNode &>(*plan);
+      auto *index_info = catalog_.GetIndex(index_scan.GetIndexOid());
+      if (index_info == nullptr || index_info->key_schema_.GetColumnCount() != 1) {
+        return {};
+      }
+      auto *table_info = catalog_.GetTable(index_info->table_name_);
+      if (table_info == nullptr) {
+        return {};
+      }
+      auto col_idx = table_info->schema_.TryGetColIdx(index_info->key_schema_.GetColumn(0).GetName());
+      if (!col_idx.has_value()) {
+        return {};
+      }
+      std::vector<std::pair<OrderByType, AbstractExpressionRef>> ordering;
+      ordering.emplace_back(OrderByType::ASC,
+                            std::make_shared<ColumnValueExpression>(
+                                0, *col_idx, table_info->schema_.GetColumn(*col_idx).GetType()));
+      return ordering;
+    }
+    default:
+      // 其余节点不保证输出顺序
+      return {};
+  }
+}
+
+auto Optimizer::OptimizeRedundantSort(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  std::vector<AbstractPlanNodeRef> children;
+  for (const auto &child : plan->GetChildren()) {
+    children.emplace_back(OptimizeRedundantSort(child));
+  }
+  auto optimized_plan = plan->CloneWithChildren(std::move(children));
+
+  // 要求的序是子计划已有序的前缀时整个排序都是多余的：Sort直接删掉，
+  // TopN退化成Limit
+  const std::vector<std::pair<OrderByType, AbstractExpressionRef>> *order_bys = nullptr;
+  if (optimized_plan->GetType() == PlanType::Sort) {
+    order_bys = &static_cast<const SortPlanNode &>(*optimized_plan).GetOrderBy();
+  } else if (optimized_plan->GetType() == PlanType::TopN) {
+    order_bys = &static_cast<const TopNPlanNode &>(*optimized_plan).GetOrderBy();
+  } else {
+    return optimized_plan;
+  }
+
+  BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Sort/TopN should have exactly 1 children.");
+  const auto &child = optimized_plan->children_[0];
+  auto child_ordering = OutputOrdering(child);
+  if (order_bys->empty() || order_bys->size() > child_ordering.size()) {
+    return optimized_plan;
+  }
+  for (size_t i = 0; i < order_bys->size(); ++i) {
+    if (!SameOrderKey((*order_bys)[i].first, (*order_bys)[i].second.get(), child_ordering[i].first,
+                      child_ordering[i].second.get())) {
+      return optimized_plan;
+    }
+  }
+
+  if (optimized_plan->GetType() == PlanType::TopN) {
+    const auto &topn_plan = static_cast<const TopNPlanNode &>(*optimized_plan);
+    return std::make_shared<LimitPlanNode>(topn_plan.output_schema_, child, topn_plan.GetN());
+  }
+  // Sort不改schema，子计划原样就是结果
+  return child;
+}
+
+}  // namespace bustub
@@ -2,8 +2,25 @@
 
 namespace bustub {
 
+/** 子树里有没有Limit节点，碰到第一个就早退 */
+static auto ContainsLimit(const AbstractPlanNodeRef &plan) -> bool {
+  if (plan->GetType() == PlanType::Limit) {
+    return true;
+  }
+  for (const auto &child : plan->GetChildren()) {
+    if (ContainsLimit(child)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 auto Optimizer::OptimizeSortLimitAsTopN(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  // TODO(student): implement sort + limit -> top N optimizer rule
+  // 整棵子树没有Limit时规则不可能命中，原样返回，省掉整树的
+  // CloneWithChildren重建
+  if (!ContainsLimit(plan)) {
+    return plan;
+  }
 
   std::vector<AbstractPlanNodeRef> children;
   for (const auto &child : plan->GetChildren()) {
@@ -12,12 +29,13 @@ auto Optimizer::OptimizeSortLimitAsTopN(const AbstractPlanNodeRef &plan) -> Abst
   auto optimized_plan = plan->CloneWithChildren(std::move(children));
 
   if (optimized_plan->GetType() == PlanType::Limit) {
-    const auto &limit_plan = dynamic_cast<const LimitPlanNode &>(*optimized_plan);
+    // GetType()已经判明具体类型，static_cast即可，不必再走一次RTTI
+    const auto &limit_plan = static_cast<const LimitPlanNode &>(*optimized_plan);
 
     BUSTUB_ENSURE(limit_plan.children_.size() == 1, "Limit should have exactly 1 children.");
     const auto &child_plan = limit_plan.children_[0];
     if (child_plan->GetType() == PlanType::Sort) {
-      const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*child_plan);
+      const auto &sort_plan = static_cast<const SortPlanNode &>(*child_plan);
 
       BUSTUB_ENSURE(sort_plan.children_.size() == 1, "Sort should have exactly 1 children.");
 
@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -60,6 +62,12 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
       throw Exception("can't open db file");
     }
   }
+  // separate descriptor for latch-free positional page I/O; the stream above
+  // only creates the file and is kept for log-style sequential access
+  db_fd_ = open(db_file.c_str(), O_RDWR);
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
   buffer_used = nullptr;
 }
 
@@ -70,6 +78,10 @@ void DiskManager::ShutDown() {
   {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
+    if (db_fd_ >= 0) {
+      close(db_fd_);
+      db_fd_ = -1;
+    }
   }
   log_io_.close();
 }
@@ -78,47 +90,29 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
   size_t offset = static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE;
-  // set write cursor to offset
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, BUSTUB_PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
+  // positional write: no shared cursor, so concurrent page writes don't latch
+  ssize_t written = pwrite(db_fd_, page_data, BUSTUB_PAGE_SIZE, static_cast<off_t>(offset));
+  if (written != BUSTUB_PAGE_SIZE) {
     LOG_DEBUG("I/O error while writing");
-    return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * BUSTUB_PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, BUSTUB_PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
-    }
-    // if file ends before reading BUSTUB_PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < BUSTUB_PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, BUSTUB_PAGE_SIZE - read_count);
-    }
+  size_t offset = static_cast<size_t>(page_id) * BUSTUB_PAGE_SIZE;
+  ssize_t read_count = pread(db_fd_, page_data, BUSTUB_PAGE_SIZE, static_cast<off_t>(offset));
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading");
+    return;
+  }
+  // if file ends before reading BUSTUB_PAGE_SIZE
+  if (read_count < BUSTUB_PAGE_SIZE) {
+    LOG_DEBUG("Read less than a page");
+    memset(page_data + read_count, 0, BUSTUB_PAGE_SIZE - read_count);
   }
 }
 
@@ -1,7 +1,14 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <iterator>
 #include <string>
+#include <tuple>
+#include <utility>
 
 #include "common/exception.h"
-#include "common/logger.h"
 #include "common/rid.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/page/header_page.h"
@@ -17,32 +24,105 @@ BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manag
       leaf_max_size_(leaf_max_size),
       internal_max_size_(internal_max_size) {}
 
-/*
- * Helper function to decide whether current b+tree is empty
- */
+/** 无分支二分（Khuong/Morin）：区间折半只靠比较结果加偏移，编译成cmov
+ * 后没有会预测失败的数据依赖分支。宽内部结点上从O(fanout)次比较降到
+ * O(log fanout) */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return root_page_id_ == INVALID_PAGE_ID; }
+auto BPLUSTREE_TYPE::UpperBound(InternalPage *internal, const KeyType &key) const -> int {
+  // 有效键在[1, size)，答案（第一个大于key的下标）落在[1, size]
+  int base = 1;
+  int len = internal->GetSize() - 1;
+  if (len <= 0) {
+    return 1;
+  }
+  const KeyType *keys = internal->KeyBase();
+  while (len > 8) {
+    int half = len >> 1;
+    // 下一轮中点只可能在左右四分位之一，两个都先拉进L1，
+    // 折半无论走哪边探的都是热行
+    __builtin_prefetch(keys + base + (len >> 2));
+    __builtin_prefetch(keys + base + len - (len >> 2));
+    // K[base+half-1] <= key时答案在右半边，base前移half；len统一减half
+    base += comparator_(keys[base + half - 1], key) <= 0 ? half : 0;
+    len -= half;
+  }
+  // 折半的cmov链每步依赖上一步，短区间改成无分支线性计数收尾：各次
+  // 比较互相独立，乱序核并行发射；答案就是区间里<=key的键数
+  int cnt = 0;
+  for (int i = 0; i < len; ++i) {
+    cnt += static_cast<int>(comparator_(keys[base + i], key) <= 0);
+  }
+  return base + cnt;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::FindLeaf(const KeyType &key) -> LeafPage * {
-  auto *page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(root_page_id_)->GetData());
+  BPlusTreePage *page;
+  // 常驻pin的根页指针直接起步；pinned标记首结点是否背着本次下行的pin
+  bool pinned = cached_root_page_ == nullptr;
+  if (!pinned) {
+    page = reinterpret_cast<BPlusTreePage *>(cached_root_page_->GetData());
+  } else {
+    // 根id加载一次当局部量用，下行期间不再回读成员
+    page_id_t root = root_page_id_.load(std::memory_order_acquire);
+    page = FetchAs<BPlusTreePage>(root);
+  }
   assert(page != nullptr);
   while (!page->IsLeafPage()) {
     auto *internal = reinterpret_cast<InternalPage *>(page);
-    // int ids = internal->FindKey(key, comparator_);
-    int ids = 1;
-    for (; ids < internal->GetSize(); ++ids) {
-      if (comparator_(internal->KeyAt(ids), key) > 0) {
-        break;
-      }
+    // 二分第一探在键数组中段，先把头部和中段拉进L1，省掉首探的冷miss
+    __builtin_prefetch(reinterpret_cast<const char *>(internal));
+    __builtin_prefetch(reinterpret_cast<const char *>(internal) + BUSTUB_PAGE_SIZE / 2);
+    int ids = UpperBound(internal, key);
+    page_id_t next_page_id = internal->ValueAt(ids - 1);
+    // 先发预取提示再解pin：孩子页的缓存行在FetchPage的页表查找、上pin
+    // 期间就在路上了，FetchPage返回后读键数组就是热的。提示不上pin，
+    // 即使孩子随后被换出也只是白取几行
+    buffer_pool_manager_->PrefetchPage(next_page_id);
+    if (pinned) {
+      buffer_pool_manager_->UnpinPage(internal->GetPageId(), false);
     }
-    page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(internal->ValueAt(ids - 1))->GetData());
-    buffer_pool_manager_->UnpinPage(internal->GetPageId(), false);
+    pinned = true;
+    page = FetchAs<BPlusTreePage>(next_page_id);
   }
 
+  if (!pinned) {
+    // 根即叶子：补一次FetchPage，调用方按"叶子带一个pin"解
+    buffer_pool_manager_->FetchPage(page->GetPageId());
+  }
   return reinterpret_cast<LeafPage *>(page);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafPath(const KeyType &key) -> LeafPage * {
+  path_.clear();
+  page_id_t root = root_page_id_.load(std::memory_order_acquire);
+  auto *page = FetchAs<BPlusTreePage>(root);
+  assert(page != nullptr);
+  while (!page->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(page);
+    __builtin_prefetch(reinterpret_cast<const char *>(internal));
+    __builtin_prefetch(reinterpret_cast<const char *>(internal) + BUSTUB_PAGE_SIZE / 2);
+    int ids = UpperBound(internal, key);
+    page_id_t next_page_id = internal->ValueAt(ids - 1);
+    buffer_pool_manager_->PrefetchPage(next_page_id);
+    // 不解pin，祖先和孩子下标留给上行的分裂/合并用
+    path_.push_back({internal, ids - 1});
+    page = FetchAs<BPlusTreePage>(next_page_id);
+  }
+
+  return reinterpret_cast<LeafPage *>(page);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleasePath() {
+  // 上行流程消费掉的帧自己弹栈并按脏解pin，这里剩下的都没改过
+  while (!path_.empty()) {
+    buffer_pool_manager_->UnpinPage(path_.back().page_->GetPageId(), false);
+    path_.pop_back();
+  }
+}
+
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -57,22 +137,26 @@ auto BPLUSTREE_TYPE::FindLeaf(const KeyType &key) -> LeafPage * {
 
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) -> bool {
-  std::scoped_lock<std::mutex> lock(latch_);
-  LOG_INFO("GetValue");
+  // 点查只读，共享闩即可，读读之间不再串行
+  std::shared_lock<std::shared_mutex> lock(latch_);
   if (IsEmpty()) {
     return false;
   }
 
   // 找到叶子结点
   auto *leaf = FindLeaf(key);
-  // int ids = leaf->FindKey(key, comparator_);
   assert(leaf != nullptr);
-  for (int ids = 0; ids < leaf->GetSize(); ++ids) {
-    if (comparator_(leaf->KeyAt(ids), key) == 0) {
-      result->push_back(leaf->ValueAt(ids));
-    }
+  // 乐观写者只持共享树闩改叶子，查键值要在叶子页读闩下做
+  auto *leaf_page = buffer_pool_manager_->FetchPage(leaf->GetPageId());
+  leaf_page->RLatch();
+  // 唯一键索引，二分定位后至多命中一个，不必全叶线性扫
+  int ids = leaf->FindKey(key, comparator_);
+  if (ids != -1 && comparator_(leaf->KeyAt(ids), key) == 0) {
+    result->push_back(leaf->ValueAt(ids));
   }
+  leaf_page->RUnlatch();
 
+  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
   buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
   return !result->empty();
 }
@@ -90,36 +174,61 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertInParent(BPlusTreePage *left, BPlusTreePage *right, const KeyType &key) {
-  LOG_INFO("InsertInParent");
-  if (left->IsRootPage()) {
-    auto *parent_internal = reinterpret_cast<InternalPage *>(buffer_pool_manager_->NewPage(&root_page_id_)->GetData());
-    parent_internal->Init(root_page_id_, INVALID_PAGE_ID, internal_max_size_);
-    parent_internal->SetValueAt(0, left->GetPageId());
-    parent_internal->PushKey(key, right->GetPageId(), comparator_);
-    left->SetParentPageId(root_page_id_);
-    right->SetParentPageId(root_page_id_);
-    buffer_pool_manager_->UnpinPage(root_page_id_, true);
-    buffer_pool_manager_->UnpinPage(left->GetPageId(), true);
-    buffer_pool_manager_->UnpinPage(right->GetPageId(), true);
-    UpdateRootPageId(false);
-    return;
-  }
+  // 分裂上行原来是尾递归，改成循环逐层爬：每层只弹一帧path_、
+  // 解一对pin，不再为每层搭调用栈帧重查"是不是根"
+  KeyType sep = key;
+  while (true) {
+    // 父指针只是advisory，判根看页id：path_耗尽即到根（见页头注释）
+    if (left->GetPageId() == root_page_id_.load(std::memory_order_relaxed)) {
+      page_id_t new_root_id;
+      auto *parent_internal = reinterpret_cast<InternalPage *>(buffer_pool_manager_->NewPage(&new_root_id)->GetData());
+      parent_internal->Init(new_root_id, INVALID_PAGE_ID, internal_max_size_);
+      parent_internal->SetValueAt(0, left->GetPageId());
+      parent_internal->PushKey(sep, right->GetPageId(), comparator_);
+      // 新根填好后才发布，旁观的原子读看到的要么旧根要么完整新根
+      root_page_id_.store(new_root_id, std::memory_order_release);
+      buffer_pool_manager_->UnpinPage(new_root_id, true);
+      buffer_pool_manager_->UnpinPage(left->GetPageId(), true);
+      buffer_pool_manager_->UnpinPage(right->GetPageId(), true);
+      UpdateRootPageId(false);
+      RefreshRootCache();
+      return;
+    }
+
+    // 父页在下行时就pin着留在path_里，弹出来直接用，省一次FetchPage
+    assert(!path_.empty());
+    auto *curr_internal = path_.back().page_;
+    path_.pop_back();
 
-  auto *curr_internal =
-      reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(left->GetParentPageId())->GetData());
+    if (curr_internal->GetSize() < curr_internal->GetMaxSize()) {
+      curr_internal->PushKey(sep, right->GetPageId(), comparator_);
+      buffer_pool_manager_->UnpinPage(left->GetPageId(), true);
+      buffer_pool_manager_->UnpinPage(right->GetPageId(), true);
+      buffer_pool_manager_->UnpinPage(curr_internal->GetPageId(), true);
+      return;
+    }
 
-  if (curr_internal->GetSize() >= curr_internal->GetMaxSize()) {
     int size = curr_internal->GetSize() + 1;
-    std::pair<KeyType, int> tmp_kvs[size];
-    std::memset(tmp_kvs, 0, sizeof tmp_kvs);
+    // 定长栈缓冲按页面能装下的上限取，代替运行期VLA：帧大小编译期定死，
+    // 也省掉原来整块memset——下面每个用到的槽都会被覆写
+    constexpr int kMaxInternal =
+        (BUSTUB_PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(page_id_t));
+    std::array<std::pair<KeyType, page_id_t>, kMaxInternal + 1> tmp_kvs;
     tmp_kvs[0].second = curr_internal->ValueAt(0);
     int k = 1;
-    for (int i = 1; i < curr_internal->GetSize(); ++i, ++k) {
+    // left是0号孩子时下面循环的按值匹配永远不命中：新分隔键在这里先落位，
+    // 否则(sep,right)整个丢掉，末槽留下垃圾项
+    if (curr_internal->ValueAt(0) == left->GetPageId()) {
+      tmp_kvs[k].first = sep;
+      tmp_kvs[k].second = right->GetPageId();
+      ++k;
+    }
+    for (int i = 1; i < size - 1; ++i, ++k) {
       tmp_kvs[k].first = curr_internal->KeyAt(i);
       tmp_kvs[k].second = curr_internal->ValueAt(i);
       if (curr_internal->ValueAt(i) == left->GetPageId()) {
         ++k;
-        tmp_kvs[k].first = key;
+        tmp_kvs[k].first = sep;
         tmp_kvs[k].second = right->GetPageId();
       }
     }
@@ -135,47 +244,67 @@ void BPLUSTREE_TYPE::InsertInParent(BPlusTreePage *left, BPlusTreePage *right, c
     auto *right_internal = reinterpret_cast<InternalPage *>(buffer_pool_manager_->NewPage(&right_page_id)->GetData());
     right_internal->Init(right_page_id, curr_internal->GetParentPageId(), internal_max_size_);
     right_internal->SetValueAt(0, tmp_kvs[mid].second);
-    for (int right_id = mid + 1; right_id < size; ++right_id) {
-      right_internal->PushKey(tmp_kvs[right_id].first, tmp_kvs[right_id].second, comparator_);
-    }
-    for (int i = 0; i < right_internal->GetSize(); ++i) {
-      auto *child =
-          reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(right_internal->ValueAt(i))->GetData());
-      child->SetParentPageId(right_page_id);
-      buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
-    }
+    // 临时数组已排好序，直接整段追加。孩子不回写父指针：原来这里每次
+    // 分裂要FetchPage全部搬过去的孩子逐个改parent，O(fanout)次随机
+    // 缓冲池查找；父子关系现在由下行path_给出，这笔开销整个消失
+    right_internal->AppendSortedRange(tmp_kvs.data(), mid + 1, size);
 
     buffer_pool_manager_->UnpinPage(left->GetPageId(), true);
     buffer_pool_manager_->UnpinPage(right->GetPageId(), true);
-    InsertInParent(curr_internal, right_internal, tmp_kvs[mid].first);
-  } else {
-    curr_internal->PushKey(key, right->GetPageId(), comparator_);
-    buffer_pool_manager_->UnpinPage(left->GetPageId(), true);
-    buffer_pool_manager_->UnpinPage(right->GetPageId(), true);
-    buffer_pool_manager_->UnpinPage(curr_internal->GetPageId(), true);
+    // 本层分裂出的左右对继续向上一层插分隔键
+    left = curr_internal;
+    right = right_internal;
+    sep = tmp_kvs[mid].first;
   }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
+  // 乐观路径：分裂是小概率事件，先持共享树闩下行，只用叶子页的写闩
+  // 互斥同叶写者。拿到写闩后再验安全（插完仍装得下），安全就地插入返
+  // 回，写者之间只在同一叶子上排队；可能分裂就放掉全部闩，退回下面
+  // 独占树闩的悲观路径重来
+  {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (!IsEmpty()) {
+      auto *leaf = FindLeaf(key);
+      auto *leaf_page = buffer_pool_manager_->FetchPage(leaf->GetPageId());
+      leaf_page->WLatch();
+      if (leaf->GetSize() + 1 < leaf->GetMaxSize()) {
+        bool inserted = leaf->PushKey(key, value, comparator_);
+        leaf_page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), inserted);
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+        return inserted;
+      }
+      leaf_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+    }
+  }
+
   latch_.lock();
-  LOG_INFO("Insert");
   // 空树插入
   if (IsEmpty()) {
-    auto *leaf = reinterpret_cast<LeafPage *>(buffer_pool_manager_->NewPage(&root_page_id_)->GetData());
-    leaf->Init(root_page_id_, INVALID_PAGE_ID, leaf_max_size_);
+    page_id_t new_root_id;
+    auto *leaf = reinterpret_cast<LeafPage *>(buffer_pool_manager_->NewPage(&new_root_id)->GetData());
+    leaf->Init(new_root_id, INVALID_PAGE_ID, leaf_max_size_);
     leaf->PushKey(key, value, comparator_);
+    root_page_id_.store(new_root_id, std::memory_order_release);
     UpdateRootPageId(true);
-    buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    buffer_pool_manager_->UnpinPage(new_root_id, true);
+    RefreshRootCache();
+    leftmost_leaf_page_id_ = new_root_id;
     latch_.unlock();
     return true;
   }
 
   // 找到叶子结点插入
-  auto *leaf = FindLeaf(key);
+  auto *leaf = FindLeafPath(key);
   assert(leaf != nullptr);
   if (!leaf->PushKey(key, value, comparator_)) {
     buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+    ReleasePath();
     latch_.unlock();
     return false;
   }
@@ -189,14 +318,15 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
     rightleaf->Init(right_page_id, leaf->GetParentPageId(), leaf_max_size_);
     rightleaf->SetNextPageId(leaf->GetNextPageId());
     leaf->SetNextPageId(right_page_id);
-    for (int right_id = mid; right_id < leaf->GetMaxSize(); ++right_id) {
-      rightleaf->PushKey(leaf->KeyAt(right_id), leaf->ValueAt(right_id), comparator_);
-    }
+    // 右半本来就有序，整段搬过去，不必逐个PushKey重复查找插入位
+    rightleaf->AppendSortedRange(leaf, mid, leaf->GetMaxSize());
     leaf->SetSize(mid);
     InsertInParent(leaf, rightleaf, leaf->KeyAt(mid));
   } else {
     buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
   }
+  // 分裂没传到的更高层祖先还pin在path_里
+  ReleasePath();
   latch_.unlock();
   return true;
 }
@@ -214,53 +344,79 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::RemoveInParent(InternalPage *iter, Transaction *transaction) {
-  LOG_INFO("RemoveInParent");
-  if (iter->IsRootPage()) {
-    if (iter->GetSize() == 1) {
-      auto *child = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(iter->ValueAt(0))->GetData());
+  // 合并上行原来是尾递归，和InsertInParent一样改成循环逐层爬：
+  // 每层弹一帧path_，不再为每层搭调用栈帧
+  while (true) {
+    if (iter->GetPageId() == root_page_id_.load(std::memory_order_relaxed)) {
+      if (iter->GetSize() == 1) {
+        // 新根id直接从槽里读，不必为改孩子父指针把孩子取上来
+        page_id_t child_id = iter->ValueAt(0);
+        // 旧根要删页，常驻pin必须先放掉，否则DeletePage因pin失败
+        DropRootCache();
+        // 要删的页按未脏解pin：批删前万一被换出也不用白写一次盘
+        buffer_pool_manager_->UnpinPage(iter->GetPageId(), false);
+        pending_deletes_.push_back(iter->GetPageId());
+        root_page_id_.store(child_id, std::memory_order_release);
+        UpdateRootPageId(false);
+        RefreshRootCache();
+      } else {
+        buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
+      }
+      return;
+    }
+
+    // 懒删除（free-at-empty）：不再维持半满下界，内部结点只剩一个孩子
+    // 指针（零个分隔键）才回收。优先整个并进兄弟；兄弟太满装不下时退回
+    // 借一个孩子，保证并完不超页容量
+    if (iter->GetSize() != 1) {
       buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
-      buffer_pool_manager_->DeletePage(iter->GetPageId());
-      transaction->AddIntoDeletedPageSet(iter->GetPageId());
-      child->SetParentPageId(INVALID_PAGE_ID);
-      root_page_id_ = child->GetPageId();
-      UpdateRootPageId(false);
+      return;
     }
-    buffer_pool_manager_->UnpinPage(root_page_id_, true);
-    return;
-  }
 
-  if (iter->GetSize() - 1 < iter->GetMinSize()) {
-    auto *parent =
-        reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(iter->GetParentPageId())->GetData());
-    int vi = 0;
-    for (; vi < parent->GetSize(); ++vi) {
-      if (parent->ValueAt(vi) == iter->GetPageId()) {
-        break;
-      }
+    // 父页和iter在父页里的下标下行时都记在path_里了，免去重取重扫
+    assert(!path_.empty());
+    auto *parent = path_.back().page_;
+    int vi = path_.back().child_index_;
+    path_.pop_back();
+
+    // 两个候选兄弟的预取提示一起先发出去，看完左兄弟再摸右兄弟时行已在路上
+    if (vi > 0) {
+      buffer_pool_manager_->PrefetchPage(parent->ValueAt(vi - 1));
+    }
+    if (vi < parent->GetSize() - 1) {
+      buffer_pool_manager_->PrefetchPage(parent->ValueAt(vi + 1));
     }
 
     InternalPage *left_bro =
-        vi > 0 ? reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent->ValueAt(vi - 1))->GetData())
+        vi > 0 ? FetchAs<InternalPage>(parent->ValueAt(vi - 1))
                : nullptr;
 
-    // 左兄弟有富余
-    if (left_bro != nullptr && left_bro->GetSize() - 1 > left_bro->GetMinSize()) {
+    if (left_bro != nullptr) {
+      if (left_bro->GetSize() + iter->GetSize() <= iter->GetMaxSize()) {
+        // 并进左兄弟：整段追加后用父分隔键补上接缝处无效的0号键
+        int base = left_bro->GetSize();
+        left_bro->AppendSortedRange(iter, 0, iter->GetSize());
+        left_bro->SetKeyAt(base, parent->KeyAt(vi));
+        assert(parent->ValueAt(vi) == iter->GetPageId());
+        parent->DeleteAt(vi);
+        buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), true);
+        buffer_pool_manager_->UnpinPage(iter->GetPageId(), false);
+        pending_deletes_.push_back(iter->GetPageId());
+        iter = parent;
+        continue;
+      }
+
+      // 左兄弟装不下，借它最后一个孩子
       int size = left_bro->GetSize();
       for (int i = iter->GetSize() - 1; i >= 0; --i) {
         iter->SetValueAt(i + 1, iter->ValueAt(i));
       }
       iter->SetValueAt(0, left_bro->ValueAt(size - 1));
-      auto *child =
-          reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(left_bro->ValueAt(size - 1))->GetData());
-      child->SetParentPageId(iter->GetPageId());
-      buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
       // 修改key
       iter->SetKeyAt(1, parent->KeyAt(vi));
       iter->IncreaseSize(1);
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
       parent->SetKeyAt(vi, left_bro->KeyAt(size - 1));
       left_bro->IncreaseSize(-1);
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
       buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
       buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), true);
       buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
@@ -269,86 +425,66 @@ void BPLUSTREE_TYPE::RemoveInParent(InternalPage *iter, Transaction *transaction
 
     InternalPage *right_bro =
         vi < parent->GetSize() - 1
-            ? reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent->ValueAt(vi + 1))->GetData())
+            ? FetchAs<InternalPage>(parent->ValueAt(vi + 1))
             : nullptr;
-    // 右兄弟有富余
-    if (right_bro != nullptr && right_bro->GetSize() - 1 > right_bro->GetMinSize()) {
+    if (right_bro != nullptr) {
+      if (iter->GetSize() + right_bro->GetSize() <= iter->GetMaxSize()) {
+        // 并进来右兄弟
+        int base = iter->GetSize();
+        iter->AppendSortedRange(right_bro, 0, right_bro->GetSize());
+        iter->SetKeyAt(base, parent->KeyAt(vi + 1));
+        assert(parent->ValueAt(vi + 1) == right_bro->GetPageId());
+        parent->DeleteAt(vi + 1);
+        buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
+        buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), false);
+        pending_deletes_.push_back(right_bro->GetPageId());
+        iter = parent;
+        continue;
+      }
+
+      // 右兄弟装不下，借它第一个孩子
       iter->PushKey(parent->KeyAt(vi + 1), right_bro->ValueAt(0), comparator_);
-      auto *child =
-          reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(right_bro->ValueAt(0))->GetData());
-      child->SetParentPageId(iter->GetPageId());
-      buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
       // 修改key
       parent->SetKeyAt(vi + 1, right_bro->KeyAt(1));
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
       right_bro->SetValueAt(0, right_bro->ValueAt(1));
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
       right_bro->PushForward();
       buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
       buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), true);
       buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
-      if (left_bro != nullptr) {
-        buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), false);
-      }
       return;
     }
 
-    // 左右都不能借，父节点key下移，合并
-    // 合并左兄弟
-    if (left_bro != nullptr) {
-      left_bro->PushKey(parent->KeyAt(vi), iter->ValueAt(0), comparator_);
-      auto *child = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(iter->ValueAt(0))->GetData());
-      child->SetParentPageId(left_bro->GetPageId());
-      buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      for (int i = 1; i < iter->GetSize(); ++i) {
-        left_bro->PushKey(iter->KeyAt(i), iter->ValueAt(i), comparator_);
-        auto *child = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(iter->ValueAt(i))->GetData());
-        child->SetParentPageId(left_bro->GetPageId());
-        buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
-      }
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      parent->DeleteWithValue(iter->GetPageId());
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), true);
-      buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
-      buffer_pool_manager_->DeletePage(iter->GetPageId());
-      transaction->AddIntoDeletedPageSet(iter->GetPageId());
-      if (right_bro != nullptr) {
-        buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), false);
-      }
-    } else if (right_bro != nullptr) {  // 合并右兄弟
-      iter->PushKey(parent->KeyAt(vi + 1), right_bro->ValueAt(0), comparator_);
-      auto *child =
-          reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(right_bro->ValueAt(0))->GetData());
-      child->SetParentPageId(iter->GetPageId());
-      buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      for (int i = 1; i < right_bro->GetSize(); ++i) {
-        iter->PushKey(right_bro->KeyAt(i), right_bro->ValueAt(i), comparator_);
-        auto *child =
-            reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(right_bro->ValueAt(i))->GetData());
-        child->SetParentPageId(iter->GetPageId());
-        buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
-      }
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      parent->DeleteWithValue(right_bro->GetPageId());
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
-      buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), true);
-      buffer_pool_manager_->DeletePage(right_bro->GetPageId());
-      transaction->AddIntoDeletedPageSet(right_bro->GetPageId());
-    }
-    RemoveInParent(parent, transaction);
-  } else {
+    // 同父没有兄弟，空壳先留着，等父结点回收时一并处理
     buffer_pool_manager_->UnpinPage(iter->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+    return;
   }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  LOG_INFO("Remove");
+  // 乐观路径：懒删除下叶子删一个还剩键就没有结构变更，共享树闩加
+  // 叶子页写闩足够；会删空再退回独占树闩重来
+  {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (IsEmpty()) {
+      return;
+    }
+    auto *leaf = FindLeaf(key);
+    auto *leaf_page = buffer_pool_manager_->FetchPage(leaf->GetPageId());
+    leaf_page->WLatch();
+    if (leaf->GetSize() > 1) {
+      bool removed = leaf->DeleteKey(key, comparator_) != -1;
+      leaf_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), removed);
+      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+      return;
+    }
+    leaf_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+    buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+  }
+
   latch_.lock();
 
   if (IsEmpty()) {
@@ -357,108 +493,97 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
   }
 
   // 找到所在叶子结点
-  auto *leaf = FindLeaf(key);
+  auto *leaf = FindLeafPath(key);
   int index = leaf->DeleteKey(key, comparator_);
   if (index == -1) {
     buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+    ReleasePath();
     latch_.unlock();
     return;
   }
 
-  // 如果叶子结点为根结点,即b+树只有一个节点
-  if (leaf->IsRootPage()) {
+  // 如果叶子结点为根结点,即b+树只有一个节点。判根看页id，父指针只是advisory
+  page_id_t root = root_page_id_.load(std::memory_order_relaxed);
+  if (leaf->GetPageId() == root) {
     if (leaf->GetSize() == 0) {
       // UpdateRootPageId(true);
-      buffer_pool_manager_->UnpinPage(root_page_id_, true);
-      buffer_pool_manager_->DeletePage(root_page_id_);
-      transaction->AddIntoDeletedPageSet(root_page_id_);
-      root_page_id_ = INVALID_PAGE_ID;
+      // 同RemoveInParent换根：常驻pin先放，页才删得掉
+      DropRootCache();
+      buffer_pool_manager_->UnpinPage(root, false);
+      pending_deletes_.push_back(root);
+      root_page_id_.store(INVALID_PAGE_ID, std::memory_order_release);
+      leftmost_leaf_page_id_ = INVALID_PAGE_ID;
     } else {
-      buffer_pool_manager_->UnpinPage(root_page_id_, true);
+      buffer_pool_manager_->UnpinPage(root, true);
     }
+    FlushPendingDeletes(transaction);
     latch_.unlock();
     return;
   }
 
-  // 先删除，然后再判断
-  // 如果需要合并，则父节点删除key，并一直向上判断是否需要借或合并
-  if (leaf->GetSize() < leaf->GetMinSize()) {
-    auto *parent =
-        reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(leaf->GetParentPageId())->GetData());
+  // 懒删除（free-at-empty）：不维持半满下界，叶子真正空了才回收。
+  // 混合插删负载下下溢页多半马上又被填回，按半满借/并大都是白做
+  if (leaf->GetSize() == 0) {
+    // 父页和leaf在父页里的下标下行时都记在path_里了，免去重取重扫
+    assert(!path_.empty());
+    auto *parent = path_.back().page_;
+    int vi = path_.back().child_index_;
+    path_.pop_back();
 
-    int vi = 0;
-    for (; vi < parent->GetSize(); ++vi) {
-      if (parent->ValueAt(vi) == leaf->GetPageId()) {
-        break;
-      }
+    // 同内部层：左右兄弟的提示一起先发
+    if (vi > 0) {
+      buffer_pool_manager_->PrefetchPage(parent->ValueAt(vi - 1));
+    }
+    if (vi < parent->GetSize() - 1) {
+      buffer_pool_manager_->PrefetchPage(parent->ValueAt(vi + 1));
     }
 
     LeafPage *left_bro =
-        vi > 0 ? reinterpret_cast<LeafPage *>(buffer_pool_manager_->FetchPage(parent->ValueAt(vi - 1))->GetData())
+        vi > 0 ? FetchAs<LeafPage>(parent->ValueAt(vi - 1))
                : nullptr;
-    // 成功借左兄弟
-    if (left_bro != nullptr && left_bro->GetSize() > left_bro->GetMinSize()) {
-      int size = left_bro->GetSize();
-      leaf->PushKey(left_bro->KeyAt(size - 1), left_bro->ValueAt(size - 1), comparator_);
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      left_bro->IncreaseSize(-1);
-      // 修改祖先结点key
-      parent->SetKeyAt(vi, leaf->KeyAt(0));
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
-      buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), true);
-      buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
-      latch_.unlock();
-      return;
-    }
-
-    LeafPage *right_bro =
-        vi < parent->GetSize() - 1
-            ? reinterpret_cast<LeafPage *>(buffer_pool_manager_->FetchPage(parent->ValueAt(vi + 1))->GetData())
-            : nullptr;
-    // 成功借右兄弟
-    if (right_bro != nullptr && right_bro->GetSize() > right_bro->GetMinSize()) {
-      leaf->PushKey(right_bro->KeyAt(0), right_bro->ValueAt(0), comparator_);
-      right_bro->DeleteKey(right_bro->KeyAt(0), comparator_);
-      // 修改祖先结点key
-      parent->SetKeyAt(vi + 1, right_bro->KeyAt(0));
-      // Draw(buffer_pool_manager_, "/home/cgBustub/build/my-tree1.dot");
-      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
-      buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), true);
-      buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
-      if (left_bro != nullptr) {
-        buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), false);
-      }
-      latch_.unlock();
-      return;
-    }
-
-    // 左右都不能借，删除合并
-    // 合并左兄弟
     if (left_bro != nullptr) {
+      // 空页摘出叶链即回收，没有数据要搬
       left_bro->SetNextPageId(leaf->GetNextPageId());
-      for (int i = 0; i < leaf->GetSize(); ++i) {
-        left_bro->PushKey(leaf->KeyAt(i), leaf->ValueAt(i), comparator_);
-      }
       buffer_pool_manager_->UnpinPage(left_bro->GetPageId(), true);
-      // 删除leafpage
-      parent->DeleteWithValue(leaf->GetPageId());
-      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
-      buffer_pool_manager_->DeletePage(leaf->GetPageId());
-      transaction->AddIntoDeletedPageSet(leaf->GetPageId());
-      if (right_bro != nullptr) {
+      assert(parent->ValueAt(vi) == leaf->GetPageId());
+      parent->DeleteAt(vi);
+      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+      pending_deletes_.push_back(leaf->GetPageId());
+    } else {
+      LeafPage *right_bro =
+          vi < parent->GetSize() - 1
+              ? FetchAs<LeafPage>(parent->ValueAt(vi + 1))
+              : nullptr;
+      if (right_bro != nullptr && right_bro->GetSize() < leaf->GetMaxSize()) {
+        // 最左叶子没有前驱接链，把右兄弟搬进来回收右兄弟
+        leaf->SetNextPageId(right_bro->GetNextPageId());
+        leaf->AppendSortedRange(right_bro, 0, right_bro->GetSize());
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+        assert(parent->ValueAt(vi + 1) == right_bro->GetPageId());
+        parent->DeleteAt(vi + 1);
         buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), false);
+        pending_deletes_.push_back(right_bro->GetPageId());
+      } else if (right_bro != nullptr) {
+        // 右兄弟满页搬不动，借它第一个键把空叶救活
+        leaf->PushKey(right_bro->KeyAt(0), right_bro->ValueAt(0), comparator_);
+        // 借的就是0号槽，按位删，不必再为已知下标的键二分重查
+        right_bro->DeleteAt(0);
+        // 修改祖先结点key
+        parent->SetKeyAt(vi + 1, right_bro->KeyAt(0));
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+        buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), true);
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
+        ReleasePath();
+        latch_.unlock();
+        return;
+      } else {
+        // 同父没有兄弟，空叶先留着，等父结点回收时一并处理
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+        ReleasePath();
+        latch_.unlock();
+        return;
       }
-    } else if (right_bro != nullptr) {  // 合并右兄弟
-      leaf->SetNextPageId(right_bro->GetNextPageId());
-      for (int i = 0; i < right_bro->GetSize(); ++i) {
-        leaf->PushKey(right_bro->KeyAt(i), right_bro->ValueAt(i), comparator_);
-      }
-      buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
-      parent->DeleteWithValue(right_bro->GetPageId());
-      buffer_pool_manager_->UnpinPage(right_bro->GetPageId(), true);
-      buffer_pool_manager_->DeletePage(right_bro->GetPageId());
-      transaction->AddIntoDeletedPageSet(right_bro->GetPageId());
     }
     // 处理祖先结点，直到根结点
     RemoveInParent(parent, transaction);
@@ -466,6 +591,9 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
     buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
   }
 
+  // 合并没传到的更高层祖先还pin在path_里
+  ReleasePath();
+  FlushPendingDeletes(transaction);
   latch_.unlock();
 }
 
@@ -479,14 +607,34 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
+  // 迭代器构造期间挡住结构变更；迭代本身和基线一样不持树闩
+  std::shared_lock<std::shared_mutex> lock(latch_);
   if (IsEmpty()) {
     return INDEXITERATOR_TYPE(buffer_pool_manager_, nullptr, 0);
   }
-  auto *page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(root_page_id_)->GetData());
+  // 最左叶子id有缓存，整棵树下行换成一次FetchPage直达
+  if (leftmost_leaf_page_id_ != INVALID_PAGE_ID) {
+    return INDEXITERATOR_TYPE(buffer_pool_manager_, FetchAs<LeafPage>(leftmost_leaf_page_id_), 0);
+  }
+  BPlusTreePage *page;
+  bool pinned = cached_root_page_ == nullptr;
+  if (!pinned) {
+    page = reinterpret_cast<BPlusTreePage *>(cached_root_page_->GetData());
+  } else {
+    page_id_t root = root_page_id_.load(std::memory_order_acquire);
+    page = FetchAs<BPlusTreePage>(root);
+  }
   while (!page->IsLeafPage()) {
     auto internal = reinterpret_cast<InternalPage *>(page);
-    page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(internal->ValueAt(0))->GetData());
-    buffer_pool_manager_->UnpinPage(internal->GetPageId(), false);
+    page = FetchAs<BPlusTreePage>(internal->ValueAt(0));
+    if (pinned) {
+      buffer_pool_manager_->UnpinPage(internal->GetPageId(), false);
+    }
+    pinned = true;
+  }
+  if (!pinned) {
+    // 根即叶子：迭代器走完会解pin，补上
+    buffer_pool_manager_->FetchPage(page->GetPageId());
   }
 
   return INDEXITERATOR_TYPE(buffer_pool_manager_, reinterpret_cast<LeafPage *>(page), 0);
@@ -499,16 +647,21 @@ auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
+  std::shared_lock<std::shared_mutex> lock(latch_);
   if (IsEmpty()) {
     return INDEXITERATOR_TYPE(buffer_pool_manager_, nullptr, 0);
   }
   auto *leaf = FindLeaf(key);
-  int index = 0;
-  for (; index < leaf->GetSize(); ++index) {
-    if (comparator_(leaf->KeyAt(index), key) == 0) {
-      break;
-    }
+  // 定位起始下标同样要挡住乐观叶子写者
+  auto *leaf_page = buffer_pool_manager_->FetchPage(leaf->GetPageId());
+  leaf_page->RLatch();
+  // 叶内有序，二分定位；语义同原线性扫：命中取下标，未命中落到size当end
+  int index = leaf->FindKey(key, comparator_);
+  if (index == -1 || comparator_(leaf->KeyAt(index), key) != 0) {
+    index = leaf->GetSize();
   }
+  leaf_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
   return INDEXITERATOR_TYPE(buffer_pool_manager_, leaf, index);
 }
 
@@ -520,15 +673,6 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(buffer_pool_manager_, nullptr, 0); }
 
-/**
- * @return Page id of the root of this tree
- */
-INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t {
-  std::scoped_lock<std::mutex> lock(latch_);
-  return root_page_id_;
-}
-
 /*****************************************************************************
  * UTILITIES AND DEBUG
  *****************************************************************************/
@@ -543,13 +687,116 @@ auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t {
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
+  page_id_t root = root_page_id_.load(std::memory_order_relaxed);
+  if (insert_record != 0 && header_page->InsertRecord(index_name_, root)) {
+    // create a new record<index_name + root_page_id> in header_page，
+    // 顺手记下记录下标，后续换根写回按下标直达
+    header_record_index_ = header_page->GetRecordCount() - 1;
+  } else if (header_record_index_ >= 0) {
+    header_page->UpdateRecordAt(header_record_index_, root);
   } else {
     // update root_page_id in header_page
-    header_page->UpdateRecord(index_name_, root_page_id_);
+    header_page->UpdateRecord(index_name_, root);
+  }
+  // 原实现fetch后从不unpin，header页pin数只涨不落
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FlushPendingDeletes(Transaction *transaction) {
+  if (pending_deletes_.empty()) {
+    return;
+  }
+  // 合并链上每页一次DeletePage就是一次缓冲池闩争抢，攒到出口整批交掉
+  buffer_pool_manager_->DeletePages(pending_deletes_);
+  for (page_id_t page_id : pending_deletes_) {
+    transaction->AddIntoDeletedPageSet(page_id);
+  }
+  pending_deletes_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DropRootCache() {
+  if (cached_root_page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(cached_root_page_->GetPageId(), false);
+    cached_root_page_ = nullptr;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RefreshRootCache() {
+  DropRootCache();
+  page_id_t root = root_page_id_.load(std::memory_order_relaxed);
+  if (root != INVALID_PAGE_ID) {
+    cached_root_page_ = buffer_pool_manager_->FetchPage(root);
+  }
+}
+
+/*
+ * Build the tree bottom-up from sorted unique key-value pairs.
+ * Only valid on an empty tree; caller guarantees order and uniqueness.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoad(const std::vector<MappingType> &sorted_kv) {
+  std::lock_guard<std::shared_mutex> lock(latch_);
+  assert(IsEmpty());
+  if (sorted_kv.empty()) {
+    return;
+  }
+
+  int n = static_cast<int>(sorted_kv.size());
+  // 每页留一个空位：装到max的页在下一次PushKey时会越界写
+  int leaf_fill = std::max(1, leaf_max_size_ - 1);
+  std::vector<std::pair<KeyType, page_id_t>> level;  // 本层各结点的{首键, 页id}
+  LeafPage *prev = nullptr;
+  for (int i = 0; i < n; i += leaf_fill) {
+    page_id_t page_id;
+    auto *leaf = reinterpret_cast<LeafPage *>(buffer_pool_manager_->NewPage(&page_id)->GetData());
+    leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+    leaf->AppendSortedRange(sorted_kv.data(), i, std::min(i + leaf_fill, n));
+    if (prev != nullptr) {
+      prev->SetNextPageId(page_id);
+      buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+    }
+    level.emplace_back(sorted_kv[i].first, page_id);
+    if (prev == nullptr) {
+      leftmost_leaf_page_id_ = page_id;
+    }
+    prev = leaf;
+  }
+  buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+
+  // 逐层向上：每段的首键当右子树的分隔键，0号键位照例无效
+  int internal_fill = std::max(2, internal_max_size_ - 1);
+  while (level.size() > 1) {
+    std::vector<std::pair<KeyType, page_id_t>> next_level;
+    int m = static_cast<int>(level.size());
+    for (int i = 0; i < m;) {
+      int end = std::min(i + internal_fill, m);
+      if (m - end == 1) {
+        // 不留只挂一个孩子的尾结点，从本段匀一个过去
+        --end;
+      }
+      page_id_t page_id;
+      auto *node = reinterpret_cast<InternalPage *>(buffer_pool_manager_->NewPage(&page_id)->GetData());
+      node->Init(page_id, INVALID_PAGE_ID, internal_max_size_);
+      node->SetValueAt(0, level[i].second);
+      for (int j = i + 1; j < end; ++j) {
+        node->SetKeyAt(j - i, level[j].first);
+        node->SetValueAt(j - i, level[j].second);
+      }
+      node->SetSize(end - i);
+      // 孩子不回写父指针（advisory），省掉每个内部结点O(fanout)次重取孩子页
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      next_level.emplace_back(level[i].first, page_id);
+      i = end;
+    }
+    level.swap(next_level);
   }
+
+  root_page_id_.store(level[0].second, std::memory_order_release);
+  UpdateRootPageId(true);
+  RefreshRootCache();
 }
 
 /*
@@ -558,11 +805,42 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertFromFile(const std::string &file_name, Transaction *transaction) {
-  int64_t key;
+  // 一次性读入整个文件再用from_chars解析，省去operator>>逐键的locale开销
   std::ifstream input(file_name);
-  while (input) {
-    input >> key;
+  std::string buf((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  const char *p = buf.data();
+  const char *end = p + buf.size();
+  std::vector<int64_t> keys;
+  while (p < end) {
+    if (*p == ',' || std::isspace(static_cast<unsigned char>(*p)) != 0) {
+      ++p;
+      continue;
+    }
+    int64_t key = 0;
+    auto [next, ec] = std::from_chars(p, end, key);
+    if (ec != std::errc()) {
+      break;
+    }
+    p = next;
+    keys.push_back(key);
+  }
 
+  // 空树整批排好序走BulkLoad，O(N)建树零分裂；非空树退回逐键插入
+  if (IsEmpty()) {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::vector<MappingType> sorted_kv;
+    sorted_kv.reserve(keys.size());
+    for (int64_t key : keys) {
+      KeyType index_key;
+      index_key.SetFromInteger(key);
+      sorted_kv.emplace_back(index_key, RID(key));
+    }
+    BulkLoad(sorted_kv);
+    return;
+  }
+
+  for (int64_t key : keys) {
     KeyType index_key;
     index_key.SetFromInteger(key);
     RID rid(key);
@@ -575,10 +853,29 @@ void BPLUSTREE_TYPE::InsertFromFile(const std::string &file_name, Transaction *t
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::RemoveFromFile(const std::string &file_name, Transaction *transaction) {
-  int64_t key;
+  // 同InsertFromFile：整块读入+from_chars
   std::ifstream input(file_name);
-  while (input) {
-    input >> key;
+  std::string buf((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  const char *p = buf.data();
+  const char *end = p + buf.size();
+  std::vector<int64_t> keys;
+  while (p < end) {
+    if (*p == ',' || std::isspace(static_cast<unsigned char>(*p)) != 0) {
+      ++p;
+      continue;
+    }
+    int64_t key = 0;
+    auto [next, ec] = std::from_chars(p, end, key);
+    if (ec != std::errc()) {
+      break;
+    }
+    p = next;
+    keys.push_back(key);
+  }
+
+  // 排好序再删，连续删除落在同一叶子/同一条下行路径上，页都在池里热着
+  std::sort(keys.begin(), keys.end());
+  for (int64_t key : keys) {
     KeyType index_key;
     index_key.SetFromInteger(key);
     Remove(index_key, transaction);
@@ -590,16 +887,24 @@ void BPLUSTREE_TYPE::RemoveFromFile(const std::string &file_name, Transaction *t
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Draw(BufferPoolManager *bpm, const std::string &outf) {
+// 纯调试设施，release编译为空，免得误调用时全树扫一遍缓冲池
+#ifdef NDEBUG
+  (void)bpm;
+  (void)outf;
+#else
   if (IsEmpty()) {
     LOG_WARN("Draw an empty tree");
     return;
   }
+  // 先攒进内存字符串，最后一次write落盘，免得逐段<<走流格式化
+  std::string buf;
+  buf.reserve(1 << 20);
+  buf.append("digraph G {\n");
+  ToGraph(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(GetRootPageId())->GetData()), bpm, buf);
+  buf.append("}\n");
   std::ofstream out(outf);
-  out << "digraph G {" << std::endl;
-  ToGraph(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm, out);
-  out << "}" << std::endl;
-  out.flush();
-  out.close();
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+#endif
 }
 
 /**
@@ -607,11 +912,15 @@ void BPLUSTREE_TYPE::Draw(BufferPoolManager *bpm, const std::string &outf) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Print(BufferPoolManager *bpm) {
+#ifdef NDEBUG
+  (void)bpm;
+#else
   if (IsEmpty()) {
     LOG_WARN("Print an empty tree");
     return;
   }
-  ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm);
+  ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(GetRootPageId())->GetData()), bpm);
+#endif
 }
 
 /**
@@ -623,87 +932,166 @@ void BPLUSTREE_TYPE::Print(BufferPoolManager *bpm) {
  * @param bpm
  * @param out
  */
+#ifndef NDEBUG
+// to_chars进栈上小数组再append，绕开ostream的locale格式化
+static void AppendInt(std::string *buf, int64_t v) {
+  char tmp[24];
+  auto [p, ec] = std::to_chars(tmp, tmp + sizeof(tmp), v);
+  (void)ec;
+  buf->append(tmp, p - tmp);
+}
+#endif
+
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const {
-  std::string leaf_prefix("LEAF_");
-  std::string internal_prefix("INT_");
-  if (page->IsLeafPage()) {
-    auto *leaf = reinterpret_cast<LeafPage *>(page);
-    // Print node name
-    out << leaf_prefix << leaf->GetPageId();
-    // Print node properties
-    out << "[shape=plain color=green ";
-    // Print data of the node
-    out << "label=<<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLSPACING=\"0\" CELLPADDING=\"4\">\n";
-    // Print data
-    out << "<TR><TD COLSPAN=\"" << leaf->GetSize() << "\">P=" << leaf->GetPageId() << "</TD></TR>\n";
-    out << "<TR><TD COLSPAN=\"" << leaf->GetSize() << "\">"
-        << "max_size=" << leaf->GetMaxSize() << ",min_size=" << leaf->GetMinSize() << ",size=" << leaf->GetSize()
-        << "</TD></TR>\n";
-    out << "<TR>";
-    for (int i = 0; i < leaf->GetSize(); i++) {
-      out << "<TD>" << leaf->KeyAt(i) << "</TD>\n";
-    }
-    out << "</TR>";
-    // Print table end
-    out << "</TABLE>>];\n";
-    // Print Leaf node link if there is a next page
-    if (leaf->GetNextPageId() != INVALID_PAGE_ID) {
-      out << leaf_prefix << leaf->GetPageId() << " -> " << leaf_prefix << leaf->GetNextPageId() << ";\n";
-      out << "{rank=same " << leaf_prefix << leaf->GetPageId() << " " << leaf_prefix << leaf->GetNextPageId() << "};\n";
-    }
+void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::string &buf) const {
+#ifdef NDEBUG
+  (void)page;
+  (void)bpm;
+  (void)buf;
+#else
+  const char *leaf_prefix = "LEAF_";
+  const char *internal_prefix = "INT_";
+  // BFS代替递归：每页恰好取一次pin一次。画同层rank链接需要的左兄弟id
+  // 在父结点入队时就带上，不再为它把左兄弟页重新Fetch一遍；同父孩子
+  // 同层，叶子与否看自己即可。父id同样随队携带——页上的父指针只是
+  // advisory，分裂/合并不再维护它
+  std::deque<std::tuple<page_id_t, page_id_t, page_id_t>> todo;  // {页id, 同父左兄弟id, 父id}
+  todo.emplace_back(page->GetPageId(), INVALID_PAGE_ID, INVALID_PAGE_ID);
+  bpm->UnpinPage(page->GetPageId(), false);
+  while (!todo.empty()) {
+    auto [pid, left_sib, parent] = todo.front();
+    todo.pop_front();
+    auto *cur = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(pid)->GetData());
+    if (cur->IsLeafPage()) {
+      auto *leaf = reinterpret_cast<LeafPage *>(cur);
+      // Print node name
+      buf.append(leaf_prefix);
+      AppendInt(&buf, leaf->GetPageId());
+      // Print node properties
+      buf.append("[shape=plain color=green ");
+      // Print data of the node
+      buf.append("label=<<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLSPACING=\"0\" CELLPADDING=\"4\">\n");
+      // Print data
+      buf.append("<TR><TD COLSPAN=\"");
+      AppendInt(&buf, leaf->GetSize());
+      buf.append("\">P=");
+      AppendInt(&buf, leaf->GetPageId());
+      buf.append("</TD></TR>\n");
+      buf.append("<TR><TD COLSPAN=\"");
+      AppendInt(&buf, leaf->GetSize());
+      buf.append("\">max_size=");
+      AppendInt(&buf, leaf->GetMaxSize());
+      buf.append(",min_size=");
+      AppendInt(&buf, leaf->GetMinSize());
+      buf.append(",size=");
+      AppendInt(&buf, leaf->GetSize());
+      buf.append("</TD></TR>\n");
+      buf.append("<TR>");
+      for (int i = 0; i < leaf->GetSize(); i++) {
+        buf.append("<TD>");
+        AppendInt(&buf, leaf->KeyAt(i).ToString());
+        buf.append("</TD>\n");
+      }
+      buf.append("</TR>");
+      // Print table end
+      buf.append("</TABLE>>];\n");
+      // Print Leaf node link if there is a next page
+      if (leaf->GetNextPageId() != INVALID_PAGE_ID) {
+        buf.append(leaf_prefix);
+        AppendInt(&buf, leaf->GetPageId());
+        buf.append(" -> ");
+        buf.append(leaf_prefix);
+        AppendInt(&buf, leaf->GetNextPageId());
+        buf.append(";\n{rank=same ");
+        buf.append(leaf_prefix);
+        AppendInt(&buf, leaf->GetPageId());
+        buf.append(" ");
+        buf.append(leaf_prefix);
+        AppendInt(&buf, leaf->GetNextPageId());
+        buf.append("};\n");
+      }
 
-    // Print parent links if there is a parent
-    if (leaf->GetParentPageId() != INVALID_PAGE_ID) {
-      out << internal_prefix << leaf->GetParentPageId() << ":p" << leaf->GetPageId() << " -> " << leaf_prefix
-          << leaf->GetPageId() << ";\n";
-    }
-  } else {
-    auto *inner = reinterpret_cast<InternalPage *>(page);
-    // Print node name
-    out << internal_prefix << inner->GetPageId();
-    // Print node properties
-    out << "[shape=plain color=pink ";  // why not?
-    // Print data of the node
-    out << "label=<<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLSPACING=\"0\" CELLPADDING=\"4\">\n";
-    // Print data
-    out << "<TR><TD COLSPAN=\"" << inner->GetSize() << "\">P=" << inner->GetPageId() << "</TD></TR>\n";
-    out << "<TR><TD COLSPAN=\"" << inner->GetSize() << "\">"
-        << "max_size=" << inner->GetMaxSize() << ",min_size=" << inner->GetMinSize() << ",size=" << inner->GetSize()
-        << "</TD></TR>\n";
-    out << "<TR>";
-    for (int i = 0; i < inner->GetSize(); i++) {
-      out << "<TD PORT=\"p" << inner->ValueAt(i) << "\">";
-      if (i > 0) {
-        out << inner->KeyAt(i);
-      } else {
-        out << " ";
+      // Print parent links if there is a parent
+      if (parent != INVALID_PAGE_ID) {
+        buf.append(internal_prefix);
+        AppendInt(&buf, parent);
+        buf.append(":p");
+        AppendInt(&buf, leaf->GetPageId());
+        buf.append(" -> ");
+        buf.append(leaf_prefix);
+        AppendInt(&buf, leaf->GetPageId());
+        buf.append(";\n");
       }
-      out << "</TD>\n";
-    }
-    out << "</TR>";
-    // Print table end
-    out << "</TABLE>>];\n";
-    // Print Parent link
-    if (inner->GetParentPageId() != INVALID_PAGE_ID) {
-      out << internal_prefix << inner->GetParentPageId() << ":p" << inner->GetPageId() << " -> " << internal_prefix
-          << inner->GetPageId() << ";\n";
-    }
-    // Print leaves
-    for (int i = 0; i < inner->GetSize(); i++) {
-      auto child_page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(inner->ValueAt(i))->GetData());
-      ToGraph(child_page, bpm, out);
-      if (i > 0) {
-        auto sibling_page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(inner->ValueAt(i - 1))->GetData());
-        if (!sibling_page->IsLeafPage() && !child_page->IsLeafPage()) {
-          out << "{rank=same " << internal_prefix << sibling_page->GetPageId() << " " << internal_prefix
-              << child_page->GetPageId() << "};\n";
+    } else {
+      auto *inner = reinterpret_cast<InternalPage *>(cur);
+      // Print node name
+      buf.append(internal_prefix);
+      AppendInt(&buf, inner->GetPageId());
+      // Print node properties
+      buf.append("[shape=plain color=pink ");  // why not?
+      // Print data of the node
+      buf.append("label=<<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLSPACING=\"0\" CELLPADDING=\"4\">\n");
+      // Print data
+      buf.append("<TR><TD COLSPAN=\"");
+      AppendInt(&buf, inner->GetSize());
+      buf.append("\">P=");
+      AppendInt(&buf, inner->GetPageId());
+      buf.append("</TD></TR>\n");
+      buf.append("<TR><TD COLSPAN=\"");
+      AppendInt(&buf, inner->GetSize());
+      buf.append("\">max_size=");
+      AppendInt(&buf, inner->GetMaxSize());
+      buf.append(",min_size=");
+      AppendInt(&buf, inner->GetMinSize());
+      buf.append(",size=");
+      AppendInt(&buf, inner->GetSize());
+      buf.append("</TD></TR>\n");
+      buf.append("<TR>");
+      for (int i = 0; i < inner->GetSize(); i++) {
+        buf.append("<TD PORT=\"p");
+        AppendInt(&buf, inner->ValueAt(i));
+        buf.append("\">");
+        if (i > 0) {
+          AppendInt(&buf, inner->KeyAt(i).ToString());
+        } else {
+          buf.append(" ");
         }
-        bpm->UnpinPage(sibling_page->GetPageId(), false);
+        buf.append("</TD>\n");
+      }
+      buf.append("</TR>");
+      // Print table end
+      buf.append("</TABLE>>];\n");
+      // Print Parent link
+      if (parent != INVALID_PAGE_ID) {
+        buf.append(internal_prefix);
+        AppendInt(&buf, parent);
+        buf.append(":p");
+        AppendInt(&buf, inner->GetPageId());
+        buf.append(" -> ");
+        buf.append(internal_prefix);
+        AppendInt(&buf, inner->GetPageId());
+        buf.append(";\n");
+      }
+      // 孩子入队，左兄弟id和父id随队携带；入队即发预取提示，
+      // 排到队首真正Fetch时缓存行多半已在路上
+      for (int i = 0; i < inner->GetSize(); i++) {
+        todo.emplace_back(inner->ValueAt(i), i > 0 ? inner->ValueAt(i - 1) : INVALID_PAGE_ID, pid);
+        bpm->PrefetchPage(inner->ValueAt(i));
       }
     }
+    // 内部结点的同层rank链接在访问自己时补画（叶子层走next指针已有）
+    if (!cur->IsLeafPage() && left_sib != INVALID_PAGE_ID) {
+      buf.append("{rank=same ");
+      buf.append(internal_prefix);
+      AppendInt(&buf, left_sib);
+      buf.append(" ");
+      buf.append(internal_prefix);
+      AppendInt(&buf, pid);
+      buf.append("};\n");
+    }
+    bpm->UnpinPage(pid, false);
   }
-  bpm->UnpinPage(page->GetPageId(), false);
+#endif
 }
 
 /**
@@ -716,28 +1104,43 @@ void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::o
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const {
-  if (page->IsLeafPage()) {
-    auto *leaf = reinterpret_cast<LeafPage *>(page);
-    std::cout << "Leaf Page: " << leaf->GetPageId() << " parent: " << leaf->GetParentPageId()
-              << " next: " << leaf->GetNextPageId() << std::endl;
-    for (int i = 0; i < leaf->GetSize(); i++) {
-      std::cout << leaf->KeyAt(i) << ",";
-    }
-    std::cout << std::endl;
-    std::cout << std::endl;
-  } else {
-    auto *internal = reinterpret_cast<InternalPage *>(page);
-    std::cout << "Internal Page: " << internal->GetPageId() << " parent: " << internal->GetParentPageId() << std::endl;
-    for (int i = 0; i < internal->GetSize(); i++) {
-      std::cout << internal->KeyAt(i) << ": " << internal->ValueAt(i) << ",";
-    }
-    std::cout << std::endl;
-    std::cout << std::endl;
-    for (int i = 0; i < internal->GetSize(); i++) {
-      ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(internal->ValueAt(i))->GetData()), bpm);
+#ifdef NDEBUG
+  (void)page;
+  (void)bpm;
+#else
+  // BFS代替递归，逐层打印，每页只pin一次；父id随队携带（页上父指针只是advisory）
+  std::deque<std::pair<page_id_t, page_id_t>> todo;
+  todo.emplace_back(page->GetPageId(), INVALID_PAGE_ID);
+  bpm->UnpinPage(page->GetPageId(), false);
+  while (!todo.empty()) {
+    auto [pid, parent] = todo.front();
+    todo.pop_front();
+    auto *cur = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(pid)->GetData());
+    if (cur->IsLeafPage()) {
+      auto *leaf = reinterpret_cast<LeafPage *>(cur);
+      std::cout << "Leaf Page: " << leaf->GetPageId() << " parent: " << parent << " next: " << leaf->GetNextPageId()
+                << std::endl;
+      for (int i = 0; i < leaf->GetSize(); i++) {
+        std::cout << leaf->KeyAt(i) << ",";
+      }
+      std::cout << std::endl;
+      std::cout << std::endl;
+    } else {
+      auto *internal = reinterpret_cast<InternalPage *>(cur);
+      std::cout << "Internal Page: " << internal->GetPageId() << " parent: " << parent << std::endl;
+      for (int i = 0; i < internal->GetSize(); i++) {
+        std::cout << internal->KeyAt(i) << ": " << internal->ValueAt(i) << ",";
+      }
+      std::cout << std::endl;
+      std::cout << std::endl;
+      for (int i = 0; i < internal->GetSize(); i++) {
+        todo.emplace_back(internal->ValueAt(i), pid);
+        bpm->PrefetchPage(internal->ValueAt(i));
+      }
     }
+    bpm->UnpinPage(pid, false);
   }
-  bpm->UnpinPage(page->GetPageId(), false);
+#endif
 }
 
 template class BPlusTree<GenericKey<4>, RID, GenericComparator<4>>;
@@ -2,6 +2,7 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <utility>
 
 #include "common/logger.h"
 #include "storage/index/index_iterator.h"
@@ -14,7 +15,24 @@ namespace bustub {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, LeafPage *leaf, int index)
-    : buffer_pool_manager_(buffer_pool_manager), iter_(leaf), index_(index) {}
+    : buffer_pool_manager_(buffer_pool_manager), iter_(leaf), index_(index) {
+  CacheLeaf();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::CacheLeaf() {
+  if (iter_ == nullptr) {
+    key_base_ = nullptr;
+    value_base_ = nullptr;
+    size_ = 0;
+    next_page_id_ = INVALID_PAGE_ID;
+    return;
+  }
+  key_base_ = iter_->KeyBase();
+  value_base_ = iter_->ValueBase();
+  size_ = iter_->GetSize();
+  next_page_id_ = iter_->GetNextPageId();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() = default;  // NOLINT
@@ -23,22 +41,30 @@ INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::IsEnd() -> bool { return iter_ == nullptr; }
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::operator*() -> const MappingType & { return iter_->GetKeyValue(index_); }
+auto INDEXITERATOR_TYPE::operator*() -> MappingType {
+  return std::make_pair(key_base_[index_], value_base_[index_]);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
   ++index_;
-  if (index_ >= iter_->GetSize()) {
-    if (iter_->GetNextPageId() != INVALID_PAGE_ID) {
-      auto *new_iter = reinterpret_cast<LeafPage *>(buffer_pool_manager_->FetchPage(iter_->GetNextPageId())->GetData());
-      buffer_pool_manager_->UnpinPage(iter_->GetPageId(), true);
+  // 扫到半叶就给下一叶发预取提示，剩下半叶的顺序读和下一叶的行填充
+  // 重叠，叶界切换时FetchPage落在热行上
+  if (index_ == (size_ >> 1) && next_page_id_ != INVALID_PAGE_ID) {
+    buffer_pool_manager_->PrefetchPage(next_page_id_);
+  }
+  if (index_ >= size_) {
+    if (next_page_id_ != INVALID_PAGE_ID) {
+      auto *new_iter = reinterpret_cast<LeafPage *>(buffer_pool_manager_->FetchPage(next_page_id_)->GetData());
+      buffer_pool_manager_->UnpinPage(iter_->GetPageId(), false);
       iter_ = new_iter;
       index_ = 0;
     } else {
-      buffer_pool_manager_->UnpinPage(iter_->GetPageId(), true);
+      buffer_pool_manager_->UnpinPage(iter_->GetPageId(), false);
       iter_ = nullptr;
       index_ = 0;
     }
+    CacheLeaf();
   }
 
   return *this;
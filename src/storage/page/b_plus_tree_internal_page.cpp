@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -39,61 +40,66 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType {
-  // replace with your own code
-  KeyType key{array_[index].first};
-  return key;
-}
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> const KeyType & { return Keys()[index]; }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { array_[index].first = key; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { Keys()[index] = key; }
 
 /*
  * Helper method to get the value associated with input "index"(a.k.a array
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { return array_[index].second; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { return Values()[index]; }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { array_[index].second = value; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { Values()[index] = value; }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::FindKey(const KeyType &key, const KeyComparator &comparator) -> int {
-  int l = 1;
-  int r = GetSize() - 1;
-  while (l <= r) {  // 找到小于等于key的位置
-    int mid = l + (r - l) / 2;
-    if (comparator(KeyAt(mid), key) > 0) {
-      r = mid - 1;
-    } else {
-      l = mid + 1;
-    }
+  // 无分支折半，同叶子页FindKey；有效键从1号槽起。
+  // 语义不变：返回最后一个<=key的下标，全大于key时返回0
+  int base = 1;
+  int len = GetSize() - 1;
+  if (len <= 0) {
+    return 0;
   }
-
-  return r;
+  const KeyType *keys = Keys();
+  while (len > 8) {
+    int half = len >> 1;
+    __builtin_prefetch(keys + base + (len >> 2));
+    __builtin_prefetch(keys + base + len - (len >> 2));
+    base += comparator(keys[base + half - 1], key) <= 0 ? half : 0;
+    len -= half;
+  }
+  // 同叶子页：短区间改线性计数，折半的串行cmov链在小fanout上反而吃亏
+  int cnt = 0;
+  for (int i = 0; i < len; ++i) {
+    cnt += static_cast<int>(comparator(keys[base + i], key) <= 0);
+  }
+  return base + cnt - 1;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PushKey(const KeyType &key, const ValueType &value,
                                              const KeyComparator &comparator) {
   int size = GetSize();
-  int i = 1;
-  for (; i < size; ++i) {
-    if (comparator(KeyAt(i), key) == 0) {
-      return;
-    }
-    if (comparator(KeyAt(i), key) > 0) {
-      break;
-    }
+  // 同叶子页：二分定位插入点，重复键直接返回；线性扫在宽结点上是O(fanout)次比较
+  int i = FindKey(key, comparator);
+  if (i >= 1 && comparator(KeyAt(i), key) == 0) {
+    return;
   }
+  ++i;
 
-  for (int j = size - 1; j >= i; --j) {
-    array_[j + 1] = array_[j];
-  }
+  // 键值两条平行数组各挪一次
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  std::memmove(keys + i + 1, keys + i, static_cast<size_t>(size - i) * sizeof(KeyType));
+  std::memmove(values + i + 1, values + i, static_cast<size_t>(size - i) * sizeof(ValueType));
 
   IncreaseSize(1);
-  array_[i] = std::make_pair(key, value);
+  keys[i] = key;
+  values[i] = value;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -109,21 +115,54 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::DeleteWithValue(const ValueType &value) {
   if (i >= size) {
     return;
   }
-  for (int j = i + 1; j < size; ++j) {
-    array_[j - 1] = array_[j];
-  }
+  DeleteAt(i);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::DeleteAt(int index) {
+  int size = GetSize();
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  std::memmove(keys + index, keys + index + 1, static_cast<size_t>(size - index - 1) * sizeof(KeyType));
+  std::memmove(values + index, values + index + 1, static_cast<size_t>(size - index - 1) * sizeof(ValueType));
 
   IncreaseSize(-1);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PushForward() {
-  for (int i = 2; i < GetSize(); ++i) {
-    array_[i - 1] = array_[i];
-  }
+  int size = GetSize();
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  std::memmove(keys + 1, keys + 2, static_cast<size_t>(size - 2) * sizeof(KeyType));
+  std::memmove(values + 1, values + 2, static_cast<size_t>(size - 2) * sizeof(ValueType));
   IncreaseSize(-1);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::AppendSortedRange(const B_PLUS_TREE_INTERNAL_PAGE_TYPE *src, int from, int to) {
+  int n = to - from;
+  if (n <= 0) {
+    return;
+  }
+  int size = GetSize();
+  std::memcpy(Keys() + size, src->Keys() + from, static_cast<size_t>(n) * sizeof(KeyType));
+  std::memcpy(Values() + size, src->Values() + from, static_cast<size_t>(n) * sizeof(ValueType));
+  IncreaseSize(n);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::AppendSortedRange(const MappingType *kvs, int from, int to) {
+  int size = GetSize();
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  for (int i = from; i < to; ++i, ++size) {
+    keys[size] = kvs[i].first;
+    values[size] = kvs[i].second;
+  }
+  SetSize(size);
+}
+
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
 template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
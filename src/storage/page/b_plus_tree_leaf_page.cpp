@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
@@ -52,26 +53,34 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_pa
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType {
-  // replace with your own code
-
-  return array_[index].first;
-}
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> const KeyType & { return Keys()[index]; }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::FindKey(const KeyType &key, const KeyComparator &comparator) -> int {
-  int l = 0;
-  int r = GetSize() - 1;
-  while (l <= r) {  // 找到小于等于key的位置
-    int mid = l + (r - l) / 2;
-    if (comparator(array_[mid].first, key) > 0) {
-      r = mid - 1;
-    } else {
-      l = mid + 1;
-    }
+  // 无分支折半（同b_plus_tree.cpp的UpperBound）：分支版的l/r更新随数据
+  // 跳，随机查找下每步都可能预测失败；偏移式更新编译成cmov，没有分支。
+  // 语义不变：返回最后一个<=key的下标，全大于key时返回-1
+  int base = 0;
+  int len = GetSize();
+  if (len <= 0) {
+    return -1;
   }
-
-  return r;
+  const KeyType *keys = Keys();
+  while (len > 8) {
+    int half = len >> 1;
+    // 下一轮中点落在左右四分位之一，两个都先拉进L1
+    __builtin_prefetch(keys + base + (len >> 2));
+    __builtin_prefetch(keys + base + len - (len >> 2));
+    base += comparator(keys[base + half - 1], key) <= 0 ? half : 0;
+    len -= half;
+  }
+  // 短区间线性计数收尾：比较互相独立可并行发射，顺序访存又对预取友好；
+  // 小页（测试里max_size个位数）整个走这条路
+  int cnt = 0;
+  for (int i = 0; i < len; ++i) {
+    cnt += static_cast<int>(comparator(keys[base + i], key) <= 0);
+  }
+  return base + cnt - 1;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -98,11 +107,13 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::PushKey(const KeyType &key, const ValueType &va
 
   IncreaseSize(1);
 
-  for (int k = size - 1; k > i; --k) {
-    array_[k + 1] = array_[k];
-  }
-
-  array_[i + 1] = std::make_pair(key, value);
+  // 键值两条平行数组各挪一次
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  std::memmove(keys + i + 2, keys + i + 1, static_cast<size_t>(size - i - 1) * sizeof(KeyType));
+  std::memmove(values + i + 2, values + i + 1, static_cast<size_t>(size - i - 1) * sizeof(ValueType));
+  keys[i + 1] = key;
+  values[i + 1] = value;
 
   return true;
 }
@@ -129,18 +140,55 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::DeleteKey(const KeyType &key, const KeyComparat
 
   IncreaseSize(-1);
 
-  for (int j = i + 1; j < size; ++j) {
-    array_[j - 1] = array_[j];
-  }
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  std::memmove(keys + i, keys + i + 1, static_cast<size_t>(size - i - 1) * sizeof(KeyType));
+  std::memmove(values + i, values + i + 1, static_cast<size_t>(size - i - 1) * sizeof(ValueType));
 
   return i;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const -> ValueType { return array_[index].second; }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::DeleteAt(int index) {
+  int size = GetSize();
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  std::memmove(keys + index, keys + index + 1, static_cast<size_t>(size - index - 1) * sizeof(KeyType));
+  std::memmove(values + index, values + index + 1, static_cast<size_t>(size - index - 1) * sizeof(ValueType));
+  IncreaseSize(-1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const -> ValueType { return Values()[index]; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::AppendSortedRange(const B_PLUS_TREE_LEAF_PAGE_TYPE *src, int from, int to) {
+  int n = to - from;
+  if (n <= 0) {
+    return;
+  }
+  int size = GetSize();
+  std::memcpy(Keys() + size, src->Keys() + from, static_cast<size_t>(n) * sizeof(KeyType));
+  std::memcpy(Values() + size, src->Values() + from, static_cast<size_t>(n) * sizeof(ValueType));
+  IncreaseSize(n);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetKeyValue(int index) -> const MappingType & { return array_[index]; }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::AppendSortedRange(const MappingType *kvs, int from, int to) {
+  int size = GetSize();
+  KeyType *keys = Keys();
+  ValueType *values = Values();
+  for (int i = from; i < to; ++i, ++size) {
+    keys[size] = kvs[i].first;
+    values[size] = kvs[i].second;
+  }
+  SetSize(size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetKeyValue(int index) -> MappingType {
+  return std::make_pair(Keys()[index], Values()[index]);
+}
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
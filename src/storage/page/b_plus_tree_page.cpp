@@ -11,51 +11,4 @@
 
 #include "storage/page/b_plus_tree_page.h"
 
-namespace bustub {
-
-/*
- * Helper methods to get/set page type
- * Page type enum class is defined in b_plus_tree_page.h
- */
-auto BPlusTreePage::IsLeafPage() const -> bool { return page_type_ == IndexPageType::LEAF_PAGE; }
-auto BPlusTreePage::IsRootPage() const -> bool { return parent_page_id_ == INVALID_PAGE_ID; }
-void BPlusTreePage::SetPageType(IndexPageType page_type) { page_type_ = page_type; }
-
-/*
- * Helper methods to get/set size (number of key/value pairs stored in that
- * page)
- */
-auto BPlusTreePage::GetSize() const -> int { return size_; }
-void BPlusTreePage::SetSize(int size) { size_ = size; }
-void BPlusTreePage::IncreaseSize(int amount) { size_ += amount; }
-
-/*
- * Helper methods to get/set max size (capacity) of the page
- */
-auto BPlusTreePage::GetMaxSize() const -> int { return max_size_; }
-void BPlusTreePage::SetMaxSize(int size) { max_size_ = size; }
-
-/*
- * Helper method to get min page size
- * Generally, min page size == max page size / 2
- */
-auto BPlusTreePage::GetMinSize() const -> int { return (max_size_ + 1) / 2; }
-
-/*
- * Helper methods to get/set parent page id
- */
-auto BPlusTreePage::GetParentPageId() const -> page_id_t { return parent_page_id_; }
-void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) { parent_page_id_ = parent_page_id; }
-
-/*
- * Helper methods to get/set self page id
- */
-auto BPlusTreePage::GetPageId() const -> page_id_t { return page_id_; }
-void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
-
-/*
- * Helper methods to set lsn
- */
-void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
-
-}  // namespace bustub
+// 访问器全部内联进头文件（见b_plus_tree_page.h），此处不再有定义
@@ -68,6 +68,17 @@ auto HeaderPage::UpdateRecord(const std::string &name, const page_id_t root_id)
   return true;
 }
 
+auto HeaderPage::UpdateRecordAt(const int index, const page_id_t root_id) -> bool {
+  if (index < 0 || index >= GetRecordCount()) {
+    return false;
+  }
+  int offset = index * 36 + 4;
+  // update record content, only root_id
+  memcpy((GetData() + offset + 32), &root_id, 4);
+
+  return true;
+}
+
 auto HeaderPage::GetRootId(const std::string &name, page_id_t *root_id) -> bool {
   assert(name.length() < 32);
 
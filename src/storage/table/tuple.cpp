@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -95,6 +96,54 @@ auto Tuple::operator=(const Tuple &other) -> Tuple & {
   return *this;
 }
 
+auto Tuple::AssembleConcat(const Schema &out_schema,
+                           std::initializer_list<std::pair<const Tuple *, const Schema *>> srcs) -> Tuple {
+  // 1. Size the output: fixed region plus every source's varlen payloads.
+  uint32_t tuple_size = out_schema.GetLength();
+  for (const auto &[src, schema] : srcs) {
+    for (auto i : schema->GetUnlinedColumns()) {
+      const char *payload = src->GetDataPtr(schema, i);
+      auto len = *reinterpret_cast<const uint32_t *>(payload);
+      if (len == BUSTUB_VALUE_NULL) {
+        len = 0;
+      }
+      tuple_size += (len + sizeof(uint32_t));
+    }
+  }
+
+  Tuple result;
+  result.allocated_ = true;
+  result.size_ = tuple_size;
+  result.data_ = new char[tuple_size];
+  std::memset(result.data_, 0, tuple_size);
+
+  // 2. Copy column bytes straight across: inlined fields land at the output
+  // column's offset, varlen payloads (size header included) are appended and
+  // their new relative offset written into the fixed region.
+  uint32_t offset = out_schema.GetLength();
+  uint32_t out_idx = 0;
+  for (const auto &[src, schema] : srcs) {
+    for (uint32_t i = 0; i < schema->GetColumnCount(); ++i, ++out_idx) {
+      const auto &out_col = out_schema.GetColumn(out_idx);
+      if (out_col.IsInlined()) {
+        std::memcpy(result.data_ + out_col.GetOffset(), src->data_ + schema->GetColumn(i).GetOffset(),
+                    out_col.GetFixedLength());
+      } else {
+        const char *payload = src->GetDataPtr(schema, i);
+        auto len = *reinterpret_cast<const uint32_t *>(payload);
+        if (len == BUSTUB_VALUE_NULL) {
+          len = 0;
+        }
+        *reinterpret_cast<uint32_t *>(result.data_ + out_col.GetOffset()) = offset;
+        std::memcpy(result.data_ + offset, payload, len + sizeof(uint32_t));
+        offset += (len + sizeof(uint32_t));
+      }
+    }
+  }
+
+  return result;
+}
+
 auto Tuple::GetValue(const Schema *schema, const uint32_t column_idx) const -> Value {
   assert(schema);
   assert(data_);